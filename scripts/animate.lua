@@ -6,13 +6,19 @@ set_size(640, 480)
 
 num_frames = 300
 
+-- Stream the frames into a single video file rather than writing images.
+stream = true
+if stream then
+  open_stream("output/animation.y4m", 30)
+end
+
 from = vec3(4, 1, 2)
 to = vec3(-4, 1, 2)
 target = vec3(0, 0, -1)
 up = vec3(0, 1, 0)
 
 for i = 1,num_frames do
-  print("Rendering frame "..tostring(i))
+  io.stderr:write("Rendering frame "..tostring(i).."\n")
   clear()
 
   c = from:lerp(to, i / num_frames)
@@ -50,5 +56,18 @@ for i = 1,num_frames do
   object_d = Object.new(sphere_d, material_d)
   add_object(object_d)
 
-  render("output/data_" .. tostring(i) .. ".jpg")
+  -- Frames are encoded in the background while the next one renders.
+  local seconds, encode_seconds
+  if stream then
+    seconds, _, encode_seconds = render_to_stream()
+  else
+    seconds, _, encode_seconds =
+      render("output/data_" .. tostring(i) .. ".jpg")
+  end
+  io.stderr:write(string.format("  render %.2fs, encode %.2fs so far\n",
+                                seconds, encode_seconds))
+end
+
+if stream then
+  close_stream()
 end
@@ -0,0 +1,38 @@
+-- Measures how trace time, and the time to build the bvh, scale with the
+-- number of objects in the scene.
+
+set_size(320, 240)
+set_samples(4)
+set_max_depth(4)
+
+look_at(0, 8, 30, 0, 0, 0, 0, 1, 0)
+set_perspective(45, 1.33, 0, 30)
+
+math.randomseed(1)
+
+ground = Object.new(Geometry.plane(0, 1, 0, -1),
+                    Material.lambertian(0.5, 0.5, 0.5))
+material = Material.lambertian(0.5, 0.5, 0.9)
+
+print("objects\tbuild\ttrace")
+for _, n in ipairs({10, 100, 1000, 10000, 100000}) do
+  clear()
+  add_object(ground)
+
+  -- Keep references around so that the objects aren't garbage collected.
+  geometries = {}
+  objects = {}
+  local radius = 4 / n ^ (1 / 3)
+  for i = 1, n do
+    local sphere = Geometry.sphere(math.random() * 20 - 10,
+                                   math.random() * 10 - 1,
+                                   math.random() * 20 - 10,
+                                   radius)
+    geometries[i] = sphere
+    objects[i] = Object.new(sphere, material)
+    add_object(objects[i])
+  end
+
+  local seconds, _, _, commit_seconds = render()
+  print(n .. "\t" .. string.format("%.3f\t%.3f", commit_seconds, seconds))
+end
@@ -0,0 +1,29 @@
+-- Renders a grid of transformed instances sharing a single geometry.
+
+set_size(640, 480)
+
+clear()
+
+look_at(0, 6, 14, 0, 0, 0, 0, 1, 0)
+set_perspective(45, 1.33, 0.1, 14)
+
+ground = Object.new(Geometry.plane(0, 1, 0, -1),
+                    Material.lambertian(0.5, 0.5, 0.5))
+add_object(ground)
+
+unit_sphere = Geometry.sphere(0, 0, 0, 1)
+material = Material.metal(0.85, 0.64, 0.12, 0.3)
+
+instances = {}
+for i = -5, 5 do
+  for j = -5, 5 do
+    local obj = Object.new(unit_sphere, material)
+    obj:scale(0.25, 0.6 + 0.05 * (i + j), 0.25)
+    obj:rotate(0, 0, 10 * i)
+    obj:translate(i, 0, j)
+    add_object(obj)
+    table.insert(instances, obj)
+  end
+end
+
+render("instances.jpg")
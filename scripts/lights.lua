@@ -0,0 +1,48 @@
+-- A closed room lit only by two small emissive spheres.
+
+set_size(640, 480)
+set_samples(64)
+set_tonemap("aces")
+
+clear()
+
+look_at(4, 1, 2, 0, 0, -1, 0, 1, 0)
+set_perspective(45, 1.33, 0, 4.5)
+
+-- The camera is inside a large sphere, so no light comes from the sky.
+sphere_r = Geometry.sphere(0, 0, -1, 8)
+material_r = Material.lambertian(0.7, 0.7, 0.7)
+object_r = Object.new(sphere_r, material_r)
+add_object(object_r)
+
+sphere_g = Geometry.sphere(0, -1000, -1, 999.5)
+material_g = Material.lambertian(0.5, 0.5, 0.5)
+object_g = Object.new(sphere_g, material_g)
+add_object(object_g)
+
+sphere_a = Geometry.sphere(-1.6, 0, -1, 0.5)
+material_a = Material.lambertian(0.5, 0.5, 0.9)
+object_a = Object.new(sphere_a, material_a)
+add_object(object_a)
+
+sphere_b = Geometry.sphere(0.0, 0.0, -1, 0.5)
+material_b = Material.metal(0.85, 0.64, 0.12, 0.3)
+object_b = Object.new(sphere_b, material_b)
+add_object(object_b)
+
+sphere_c = Geometry.sphere(1.6, 0.0, -1, 0.5)
+material_c = Material.dielectric(1.5)
+object_c = Object.new(sphere_c, material_c)
+add_object(object_c)
+
+sphere_l = Geometry.sphere(0, 2.5, -0.5, 0.15)
+material_l = Material.emissive(400, 380, 300)
+object_l = Object.new(sphere_l, material_l)
+add_object(object_l)
+
+sphere_m = Geometry.sphere(2.5, 0.5, 1, 0.05)
+material_m = Material.emissive(500, 800, 2000)
+object_m = Object.new(sphere_m, material_m)
+add_object(object_m)
+
+render("lights.jpg")
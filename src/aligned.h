@@ -0,0 +1,54 @@
+// Copyright 2018, Vahid Kazemi
+
+#ifndef ALIGNED_H_
+#define ALIGNED_H_
+
+#include <stdlib.h>
+#include <new>
+#include <vector>
+
+// Allocator for vectors whose storage must be aligned for SIMD loads.
+template<class T, size_t Alignment = 32>
+class AlignedAllocator {
+ public:
+  typedef T value_type;
+
+  template<class U>
+  struct rebind {
+    typedef AlignedAllocator<U, Alignment> other;
+  };
+
+  AlignedAllocator() = default;
+
+  template<class U>
+  AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+  T* allocate(size_t n) {
+    void* p = nullptr;
+    if (posix_memalign(&p, Alignment, n * sizeof(T)) != 0) {
+      throw std::bad_alloc();
+    }
+    return static_cast<T*>(p);
+  }
+
+  void deallocate(T* p, size_t) {
+    free(p);
+  }
+};
+
+template<class T, class U, size_t Alignment>
+bool operator==(const AlignedAllocator<T, Alignment>&,
+                const AlignedAllocator<U, Alignment>&) {
+  return true;
+}
+
+template<class T, class U, size_t Alignment>
+bool operator!=(const AlignedAllocator<T, Alignment>&,
+                const AlignedAllocator<U, Alignment>&) {
+  return false;
+}
+
+template<class T>
+using AlignedVector = std::vector<T, AlignedAllocator<T>>;
+
+#endif  // ALIGNED_H_
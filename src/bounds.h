@@ -0,0 +1,80 @@
+// Copyright 2018, Vahid Kazemi
+
+#ifndef BOUNDS_H_
+#define BOUNDS_H_
+
+#include <float.h>
+#include <algorithm>
+
+#include "./ray.h"
+#include "./vec3.h"
+
+// Axis aligned bounding box. A default constructed box is empty.
+struct Bounds {
+  Bounds()
+  : min(FLT_MAX, FLT_MAX, FLT_MAX), max(-FLT_MAX, -FLT_MAX, -FLT_MAX) {}
+  Bounds(const Vec3f& min, const Vec3f& max) : min(min), max(max) {}
+
+  static Bounds Infinite() {
+    return Bounds(Vec3f(-FLT_MAX, -FLT_MAX, -FLT_MAX),
+                  Vec3f(FLT_MAX, FLT_MAX, FLT_MAX));
+  }
+
+  Vec3f min;
+  Vec3f max;
+};
+
+inline Bounds Union(const Bounds& a, const Bounds& b) {
+  return Bounds(Min(a.min, b.min), Max(a.max, b.max));
+}
+
+inline Bounds Union(const Bounds& a, const Vec3f& p) {
+  return Bounds(Min(a.min, p), Max(a.max, p));
+}
+
+inline Vec3f Centroid(const Bounds& b) {
+  return (b.min + b.max) * 0.5f;
+}
+
+inline Vec3f Extent(const Bounds& b) {
+  return b.max - b.min;
+}
+
+inline float SurfaceArea(const Bounds& b) {
+  Vec3f e = Extent(b);
+  if (e.x < 0 || e.y < 0 || e.z < 0) {
+    return 0;
+  }
+  return 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+}
+
+// Returns the axis along which the box is the widest.
+inline int MaxAxis(const Bounds& b) {
+  Vec3f e = Extent(b);
+  if (e.x >= e.y && e.x >= e.z) return 0;
+  return e.y >= e.z ? 1 : 2;
+}
+
+inline Vec3f Reciprocal(const Vec3f& v) {
+  return Vec3f(1.0f / v.x, 1.0f / v.y, 1.0f / v.z);
+}
+
+// Slab test. inv_dir is the per component reciprocal of the ray direction.
+inline bool Intersect(const Bounds& b, const Vec3f& origin,
+                      const Vec3f& inv_dir, float start, float end) {
+  for (int i = 0; i < 3; ++i) {
+    float t0 = (b.min.v[i] - origin.v[i]) * inv_dir.v[i];
+    float t1 = (b.max.v[i] - origin.v[i]) * inv_dir.v[i];
+    if (inv_dir.v[i] < 0) {
+      std::swap(t0, t1);
+    }
+    start = t0 > start ? t0 : start;
+    end = t1 < end ? t1 : end;
+    if (end < start) {
+      return false;
+    }
+  }
+  return true;
+}
+
+#endif  // BOUNDS_H_
@@ -0,0 +1,144 @@
+// Copyright 2018, Vahid Kazemi
+
+#include <algorithm>
+
+#include "./bvh.h"
+
+namespace {
+
+const int kNumBins = 16;
+const float kTraversalCost = 1.0f;
+const float kIntersectionCost = 1.0f;
+
+struct Bin {
+  Bounds bounds;
+  int count = 0;
+};
+
+}  // namespace
+
+void Bvh::Build(const std::vector<Bounds>& bounds, int max_leaf_size) {
+  Clear();
+  int count = static_cast<int>(bounds.size());
+  if (count == 0) {
+    return;
+  }
+
+  std::vector<Vec3f> centroids(count);
+  indices_.resize(count);
+  for (int i = 0; i < count; ++i) {
+    centroids[i] = Centroid(bounds[i]);
+    indices_[i] = i;
+  }
+
+  nodes_.reserve(2 * count - 1);
+  BuildRecursive(bounds, centroids, 0, count, 0, std::max(max_leaf_size, 1));
+}
+
+void Bvh::Clear() {
+  nodes_.clear();
+  indices_.clear();
+}
+
+int Bvh::BuildRecursive(const std::vector<Bounds>& bounds,
+                        const std::vector<Vec3f>& centroids,
+                        int first, int count, int depth, int max_leaf_size) {
+  int node_index = static_cast<int>(nodes_.size());
+  nodes_.emplace_back();
+
+  Bounds node_bounds;
+  Bounds centroid_bounds;
+  for (int i = first; i < first + count; ++i) {
+    node_bounds = Union(node_bounds, bounds[indices_[i]]);
+    centroid_bounds = Union(centroid_bounds, centroids[indices_[i]]);
+  }
+  nodes_[node_index].bounds = node_bounds;
+
+  auto make_leaf = [&]() {
+    nodes_[node_index].offset = first;
+    nodes_[node_index].count = count;
+    nodes_[node_index].axis = 0;
+    return node_index;
+  };
+
+  int axis = MaxAxis(centroid_bounds);
+  float min_c = centroid_bounds.min.v[axis];
+  float max_c = centroid_bounds.max.v[axis];
+  if (count == 1 || depth >= kMaxDepth - 1) {
+    return make_leaf();
+  }
+
+  int mid;
+  if (max_c <= min_c) {
+    // All centroids coincide, SAH can't separate them.
+    if (count <= max_leaf_size) {
+      return make_leaf();
+    }
+    mid = first + count / 2;
+  } else {
+    // Bin the centroids along the widest axis and evaluate the SAH cost of
+    // splitting between every pair of adjacent bins.
+    Bin bins[kNumBins];
+    float scale = kNumBins / (max_c - min_c);
+    auto bin_index = [&](int i) {
+      int b = static_cast<int>((centroids[i].v[axis] - min_c) * scale);
+      return std::min(b, kNumBins - 1);
+    };
+    for (int i = first; i < first + count; ++i) {
+      Bin& bin = bins[bin_index(indices_[i])];
+      bin.count++;
+      bin.bounds = Union(bin.bounds, bounds[indices_[i]]);
+    }
+
+    float right_area[kNumBins];
+    int right_count[kNumBins];
+    Bounds acc;
+    int acc_count = 0;
+    for (int i = kNumBins - 1; i > 0; --i) {
+      acc = Union(acc, bins[i].bounds);
+      acc_count += bins[i].count;
+      right_area[i] = SurfaceArea(acc);
+      right_count[i] = acc_count;
+    }
+
+    float best_cost = FLT_MAX;
+    int best_split = -1;
+    acc = Bounds();
+    acc_count = 0;
+    for (int i = 0; i < kNumBins - 1; ++i) {
+      acc = Union(acc, bins[i].bounds);
+      acc_count += bins[i].count;
+      if (acc_count == 0 || right_count[i + 1] == 0) {
+        continue;
+      }
+      float cost = SurfaceArea(acc) * acc_count +
+                   right_area[i + 1] * right_count[i + 1];
+      if (cost < best_cost) {
+        best_cost = cost;
+        best_split = i;
+      }
+    }
+
+    float area = SurfaceArea(node_bounds);
+    float leaf_cost = kIntersectionCost * count;
+    float split_cost = kTraversalCost +
+        (area > 0 ? kIntersectionCost * best_cost / area : leaf_cost);
+    if (count <= max_leaf_size && split_cost >= leaf_cost) {
+      return make_leaf();
+    }
+
+    int* split = std::partition(
+      &indices_[first], &indices_[first] + count,
+      [&](int i) { return bin_index(i) <= best_split; });
+    mid = static_cast<int>(split - &indices_[0]);
+  }
+
+  BuildRecursive(bounds, centroids, first, mid - first,
+                 depth + 1, max_leaf_size);
+  int second = BuildRecursive(bounds, centroids, mid, first + count - mid,
+                              depth + 1, max_leaf_size);
+  nodes_[node_index].offset = second;
+  nodes_[node_index].count = 0;
+  nodes_[node_index].axis = axis;
+  return node_index;
+}
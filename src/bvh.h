@@ -0,0 +1,225 @@
+// Copyright 2018, Vahid Kazemi
+
+#ifndef BVH_H_
+#define BVH_H_
+
+#include <vector>
+
+#include "./bounds.h"
+#include "./ray.h"
+#include "./simd.h"
+
+struct BvhNode {
+  Bounds bounds;
+  // First primitive for leaves, index of the second child for interior nodes.
+  // The first child of an interior node always follows its parent.
+  int offset;
+  // Number of primitives in a leaf, zero for interior nodes.
+  int count;
+  // Split axis of interior nodes.
+  int axis;
+};
+
+// Bounding volume hierarchy built with the surface area heuristic.
+// The hierarchy only stores primitive indices, so it can be used for any
+// primitive type that can provide its bounds.
+class Bvh {
+ public:
+  // Deeper subtrees are collapsed into leaves to bound the traversal stack.
+  static const int kMaxDepth = 64;
+
+  Bvh() = default;
+
+  void Build(const std::vector<Bounds>& bounds, int max_leaf_size = 4);
+  void Clear();
+
+  bool Empty() const { return nodes_.empty(); }
+  Bounds GetBounds() const { return Empty() ? Bounds() : nodes_[0].bounds; }
+
+  // Primitives are reordered during the build so that every leaf references
+  // a contiguous range. Returns the original index of the i-th primitive.
+  int Primitive(int i) const { return indices_[i]; }
+  const std::vector<int>& Primitives() const { return indices_; }
+
+  // Visits the leaves hit by the ray in front to back order. For every leaf
+  // intersect(first, count, &end) is called which is expected to shrink end
+  // to the distance of the closest hit found so far.
+  template<class F>
+  void Traverse(const Ray& ray, float start, float end, F intersect) const;
+
+  // Visits the leaves hit by the ray until intersect(first, count) returns
+  // true for one of them, for queries which only need any hit. Returns
+  // whether it did.
+  template<class F>
+  bool TraverseAny(const Ray& ray, float start, float end,
+                   F intersect) const;
+
+  // Traverses the hierarchy with all rays of a packet at once. A node is
+  // visited if any of the rays hits it and children are ordered by the
+  // direction of the first ray. ends holds the closest hit of every ray and
+  // is updated by intersect(first, count, ends) like in Traverse.
+  template<class F>
+  void TraversePacket(const RayPacket& packet, float start, float* ends,
+                      F intersect) const;
+
+ private:
+  int BuildRecursive(const std::vector<Bounds>& bounds,
+                     const std::vector<Vec3f>& centroids,
+                     int first, int count, int depth, int max_leaf_size);
+
+  std::vector<BvhNode> nodes_;
+  std::vector<int> indices_;
+};
+
+template<class F>
+void Bvh::Traverse(const Ray& ray, float start, float end, F intersect) const {
+  if (nodes_.empty()) {
+    return;
+  }
+  Vec3f inv_dir = Reciprocal(ray.direction);
+  int dir_is_neg[3] = {
+    inv_dir.x < 0, inv_dir.y < 0, inv_dir.z < 0
+  };
+
+  int stack[kMaxDepth];
+  int stack_size = 0;
+  int node_index = 0;
+  while (true) {
+    const BvhNode& node = nodes_[node_index];
+    if (Intersect(node.bounds, ray.origin, inv_dir, start, end)) {
+      if (node.count > 0) {
+        intersect(node.offset, node.count, &end);
+      } else if (dir_is_neg[node.axis]) {
+        stack[stack_size++] = node_index + 1;
+        node_index = node.offset;
+        continue;
+      } else {
+        stack[stack_size++] = node.offset;
+        node_index = node_index + 1;
+        continue;
+      }
+    }
+    if (stack_size == 0) {
+      break;
+    }
+    node_index = stack[--stack_size];
+  }
+}
+
+template<class F>
+bool Bvh::TraverseAny(const Ray& ray, float start, float end,
+                      F intersect) const {
+  if (nodes_.empty()) {
+    return false;
+  }
+  Vec3f inv_dir = Reciprocal(ray.direction);
+  int dir_is_neg[3] = {
+    inv_dir.x < 0, inv_dir.y < 0, inv_dir.z < 0
+  };
+
+  int stack[kMaxDepth];
+  int stack_size = 0;
+  int node_index = 0;
+  while (true) {
+    const BvhNode& node = nodes_[node_index];
+    if (Intersect(node.bounds, ray.origin, inv_dir, start, end)) {
+      if (node.count > 0) {
+        if (intersect(node.offset, node.count)) {
+          return true;
+        }
+      } else if (dir_is_neg[node.axis]) {
+        stack[stack_size++] = node_index + 1;
+        node_index = node.offset;
+        continue;
+      } else {
+        stack[stack_size++] = node.offset;
+        node_index = node_index + 1;
+        continue;
+      }
+    }
+    if (stack_size == 0) {
+      return false;
+    }
+    node_index = stack[--stack_size];
+  }
+}
+
+template<class F>
+void Bvh::TraversePacket(const RayPacket& packet, float start, float* ends,
+                         F intersect) const {
+  if (nodes_.empty() || packet.size == 0) {
+    return;
+  }
+  using namespace simd;  // NOLINT
+
+  // Inactive lanes get an empty interval so that they never hit a node.
+  const int num_lanes = (packet.size + kWidth - 1) / kWidth * kWidth;
+  alignas(32) float inv_x[RayPacket::kMaxSize];
+  alignas(32) float inv_y[RayPacket::kMaxSize];
+  alignas(32) float inv_z[RayPacket::kMaxSize];
+  for (int i = 0; i < num_lanes; ++i) {
+    if (i < packet.size) {
+      inv_x[i] = 1.0f / packet.direction_x[i];
+      inv_y[i] = 1.0f / packet.direction_y[i];
+      inv_z[i] = 1.0f / packet.direction_z[i];
+    } else {
+      inv_x[i] = inv_y[i] = inv_z[i] = 1.0f;
+      ends[i] = -1.0f;
+    }
+  }
+  int dir_is_neg[3] = {
+    inv_x[0] < 0, inv_y[0] < 0, inv_z[0] < 0
+  };
+  const Float vstart = Set(start);
+
+  auto any_hit = [&](const Bounds& b) {
+    for (int i = 0; i < num_lanes; i += kWidth) {
+      Float t_min = vstart;
+      Float t_max = Load(&ends[i]);
+      Float t0 = Mul(Sub(Set(b.min.x), Load(&packet.origin_x[i])),
+                     Load(&inv_x[i]));
+      Float t1 = Mul(Sub(Set(b.max.x), Load(&packet.origin_x[i])),
+                     Load(&inv_x[i]));
+      t_min = Max(Min(t0, t1), t_min);
+      t_max = Min(Max(t0, t1), t_max);
+      t0 = Mul(Sub(Set(b.min.y), Load(&packet.origin_y[i])), Load(&inv_y[i]));
+      t1 = Mul(Sub(Set(b.max.y), Load(&packet.origin_y[i])), Load(&inv_y[i]));
+      t_min = Max(Min(t0, t1), t_min);
+      t_max = Min(Max(t0, t1), t_max);
+      t0 = Mul(Sub(Set(b.min.z), Load(&packet.origin_z[i])), Load(&inv_z[i]));
+      t1 = Mul(Sub(Set(b.max.z), Load(&packet.origin_z[i])), Load(&inv_z[i]));
+      t_min = Max(Min(t0, t1), t_min);
+      t_max = Min(Max(t0, t1), t_max);
+      if (MoveMask(Less(t_max, t_min)) != (1 << kWidth) - 1) {
+        return true;
+      }
+    }
+    return false;
+  };
+
+  int stack[kMaxDepth];
+  int stack_size = 0;
+  int node_index = 0;
+  while (true) {
+    const BvhNode& node = nodes_[node_index];
+    if (any_hit(node.bounds)) {
+      if (node.count > 0) {
+        intersect(node.offset, node.count, ends);
+      } else if (dir_is_neg[node.axis]) {
+        stack[stack_size++] = node_index + 1;
+        node_index = node.offset;
+        continue;
+      } else {
+        stack[stack_size++] = node.offset;
+        node_index = node_index + 1;
+        continue;
+      }
+    }
+    if (stack_size == 0) {
+      break;
+    }
+    node_index = stack[--stack_size];
+  }
+}
+
+#endif  // BVH_H_
@@ -4,7 +4,7 @@
 #include <math.h>
 
 #include "./camera.h"
-#include "./rand.h"
+#include "./sampling.h"
 
 Camera::Camera(const Vec3f& from, const Vec3f& to, const Vec3f& up,
                float fovy, float aspect, float aperture, float focus_dist) {
@@ -41,11 +41,25 @@ void Camera::Update() {
                 (width_ * horizontal_ + height_ * vertical_) * 0.5f;
 }
 
-Ray Camera::GetRay(float u, float v) const {
-  Vec3f rnd = Random::PointInUnitDisk() * lens_radius_;
+Ray Camera::GetRay(int i, int j, int width, int height,
+                   Sampler* sampler) const {
+  Vec2f jitter = sampler->Get2D();
+  float u = (i + jitter.x) / width;
+  float v = 1 - (j + jitter.y) / height;
+  Vec2f rnd = SampleConcentricDisk(sampler->Get2D()) * lens_radius_;
   Vec3f from = origin_ + horizontal_ * rnd.x + vertical_ * rnd.y;
   Vec3f to = lower_left_ +
               horizontal_ * width_ * u +
               vertical_ * height_ * v;
   return Ray(from, Normal(to - from));
 }
+
+void Camera::Hash(Hasher* hasher) const {
+  hasher->Add(origin_);
+  hasher->Add(lower_left_);
+  hasher->Add(horizontal_);
+  hasher->Add(vertical_);
+  hasher->Add(width_);
+  hasher->Add(height_);
+  hasher->Add(lens_radius_);
+}
@@ -3,7 +3,9 @@
 #ifndef CAMERA_H_
 #define CAMERA_H_
 
+#include "./hash.h"
 #include "./ray.h"
+#include "./sampler.h"
 #include "./vec3.h"
 
 class Camera {
@@ -15,7 +17,11 @@ class Camera {
                       float focus_dist);
   void LookAt(const Vec3f& from, const Vec3f& to, const Vec3f& up);
 
-  Ray GetRay(float u, float v) const;
+  // Returns a ray through pixel (i, j) of a width x height image. The
+  // sampler provides the position within the pixel and on the lens.
+  Ray GetRay(int i, int j, int width, int height, Sampler* sampler) const;
+
+  void Hash(Hasher* hasher) const;
 
  private:
   void Update();
@@ -38,6 +38,10 @@ struct RGBA {
   };
 };
 
+inline float Luminance(const Vec3f& c) {
+  return 0.2126f * c.x + 0.7152f * c.y + 0.0722f * c.z;
+}
+
 inline Vec3f GammaCorrect(const Vec3f& c, float gamma) {
   float e = 1 / gamma;
   return Vec3f(powf(c.x, e), powf(c.y, e), powf(c.z, e));
@@ -51,8 +55,13 @@ inline RGBA Vec3fToRGBA(const Vec3f& c) {
     255);
 }
 
+// Maps the components of a unit normal from [-1, 1] to [0, 1].
+inline Vec3f NormalToColor(const Vec3f& n) {
+  return n * 0.5f + Vec3f(0.5f, 0.5f, 0.5f);
+}
+
 inline RGBA NormalToRGBA(const Vec3f& n) {
-  return Vec3fToRGBA(n * 0.5f + Vec3f(0.5f, 0.5f, 0.5f));
+  return Vec3fToRGBA(NormalToColor(n));
 }
 
 #endif  // COLOR_H_
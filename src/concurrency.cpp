@@ -0,0 +1,134 @@
+// Copyright 2018, Vahid Kazemi
+
+#include <stdint.h>
+#include <algorithm>
+
+#include "./concurrency.h"
+
+ThreadPool::ThreadPool(int num_threads) : pending_(0), stop_(false) {
+  Start(num_threads);
+}
+
+ThreadPool::~ThreadPool() {
+  Stop();
+}
+
+ThreadPool& ThreadPool::Default() {
+  static ThreadPool pool;
+  return pool;
+}
+
+void ThreadPool::SetNumThreads(int num_threads) {
+  Stop();
+  Start(num_threads);
+}
+
+void ThreadPool::Start(int num_threads) {
+  if (num_threads <= 0) {
+    num_threads = std::max<int>(std::thread::hardware_concurrency(), 1);
+  }
+  stop_ = false;
+  queues_.clear();
+  for (int i = 0; i < num_threads; ++i) {
+    queues_.emplace_back(new Queue());
+  }
+  // Queue zero belongs to the thread submitting the jobs.
+  for (int i = 1; i < num_threads; ++i) {
+    threads_.emplace_back([this, i]() { WorkerLoop(i); });
+  }
+}
+
+void ThreadPool::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  work_cv_.notify_all();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+  threads_.clear();
+}
+
+void ThreadPool::ParallelFor(int start, int end,
+                             const std::function<void(int)>& f) {
+  int count = end - start;
+  if (count <= 0) {
+    return;
+  }
+
+  Job job;
+  job.f = &f;
+  job.remaining = count;
+
+  int num_queues = NumThreads();
+  for (int q = 0; q < num_queues; ++q) {
+    int first = start + static_cast<int>(int64_t(count) * q / num_queues);
+    int last = start + static_cast<int>(int64_t(count) * (q + 1) / num_queues);
+    std::lock_guard<std::mutex> lock(queues_[q]->mutex);
+    for (int i = first; i < last; ++i) {
+      queues_[q]->tasks.push_back({&job, i});
+    }
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_ += count;
+  }
+  work_cv_.notify_all();
+
+  Task task;
+  while (job.remaining > 0) {
+    if (Pop(0, &task)) {
+      Run(task);
+    } else {
+      std::unique_lock<std::mutex> lock(mutex_);
+      done_cv_.wait(lock, [&]() { return job.remaining == 0 || pending_ > 0; });
+    }
+  }
+}
+
+void ThreadPool::WorkerLoop(int id) {
+  Task task;
+  while (true) {
+    if (Pop(id, &task)) {
+      Run(task);
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    work_cv_.wait(lock, [this]() { return stop_ || pending_ > 0; });
+    if (stop_) {
+      return;
+    }
+  }
+}
+
+bool ThreadPool::Pop(int id, Task* task) {
+  int num_queues = NumThreads();
+  for (int k = 0; k < num_queues; ++k) {
+    Queue& queue = *queues_[(id + k) % num_queues];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty()) {
+      continue;
+    }
+    if (k == 0) {
+      *task = queue.tasks.front();
+      queue.tasks.pop_front();
+    } else {
+      *task = queue.tasks.back();
+      queue.tasks.pop_back();
+    }
+    pending_--;
+    return true;
+  }
+  return false;
+}
+
+void ThreadPool::Run(const Task& task) {
+  (*task.job->f)(task.index);
+  if (--task.job->remaining == 0) {
+    // Take the lock so the notification can't slip in between the waiting
+    // thread's check and its wait.
+    std::lock_guard<std::mutex> lock(mutex_);
+    done_cv_.notify_all();
+  }
+}
@@ -3,35 +3,73 @@
 #ifndef CONCURRENCY_H_
 #define CONCURRENCY_H_
 
-#include <math.h>
-#include <algorithm>
-#include <iostream>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <thread>
 #include <vector>
 
+// Long lived pool of worker threads. Every worker owns a deque of tasks,
+// takes work from its front and steals from the back of the others when it
+// runs dry. The thread which submits a job works on it as well.
+class ThreadPool {
+ public:
+  // Zero uses one thread per hardware thread.
+  explicit ThreadPool(int num_threads = 0);
+  ~ThreadPool();
+
+  // Pool shared by the renderer.
+  static ThreadPool& Default();
+
+  // Must not be called while a job is running.
+  void SetNumThreads(int num_threads);
+  int NumThreads() const { return static_cast<int>(queues_.size()); }
+
+  // Runs f(i) for every i in [start, end) and waits for all of them. The
+  // indices are dealt out to the workers in contiguous blocks, so nearby
+  // indices tend to run on the same thread.
+  void ParallelFor(int start, int end, const std::function<void(int)>& f);
+
+ private:
+  struct Job {
+    const std::function<void(int)>* f;
+    std::atomic<int> remaining;
+  };
+
+  struct Task {
+    Job* job;
+    int index;
+  };
+
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  void Start(int num_threads);
+  void Stop();
+  void WorkerLoop(int id);
+  // Pops a task from the queue of the given worker or steals one.
+  bool Pop(int id, Task* task);
+  void Run(const Task& task);
+
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::vector<std::thread> threads_;
+  std::atomic<int> pending_;
+  std::mutex mutex_;
+  std::condition_variable work_cv_;
+  std::condition_variable done_cv_;
+  bool stop_;
+};
+
 template<class F, class T>
-void ParallelFor(T start, T end, F f, uint32_t num_threads = 0) {
-  if (num_threads == 0) {
-    num_threads = std::thread::hardware_concurrency();
-  }
-  const T len = end - start;
-  if (num_threads > len) {
-    num_threads = len;
-  }
-  const T stride = (T)ceil(float(len) / float(num_threads));
-  std::vector<std::thread> threads;
-
-  for (T i = start; i < end; i += stride) {
-    T max_i = std::min(i + stride, end);
-    threads.emplace_back([=]() {
-      for (T j = i; j < max_i; ++j) {
-        f(j);
-      }
-    });
-  }
-  for (auto& thread : threads) {
-    thread.join();
-  }
+void ParallelFor(T start, T end, F f) {
+  std::function<void(int)> func = [&f](int i) { f(static_cast<T>(i)); };
+  ThreadPool::Default().ParallelFor(static_cast<int>(start),
+                                    static_cast<int>(end), func);
 }
 
 #endif  // CONCURRENCY_H_
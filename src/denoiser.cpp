@@ -0,0 +1,246 @@
+// Copyright 2018, Vahid Kazemi
+
+#include <algorithm>
+
+#include "./concurrency.h"
+#include "./denoiser.h"
+#include "./material.h"
+#include "./math.h"
+#include "./simd.h"
+
+namespace {
+
+// B3 spline, the weights of the taps of each row and column.
+const float kKernel[5] = { 1 / 16.0f, 1 / 4.0f, 3 / 8.0f, 1 / 4.0f,
+                           1 / 16.0f };
+
+// Keeps the depth weight finite for pixels without a hit.
+const float kMinDepth = 1e-3f;
+
+// Planes of Denoiser::features_.
+enum Feature {
+  kNormalX, kNormalY, kNormalZ,
+  kAlbedoX, kAlbedoY, kAlbedoZ,
+  kDepth,
+  kNumFeatures,
+};
+
+// exp(-x) approximated as (1 - x / 8)^8, which needs no transcendental
+// functions and reaches zero at x = 8.
+inline simd::Float ExpNeg(simd::Float x) {
+  simd::Float t = simd::Max(simd::Sub(simd::Set(1.0f),
+                                      simd::Mul(x, simd::Set(0.125f))),
+                            simd::Set(0.0f));
+  t = simd::Mul(t, t);
+  t = simd::Mul(t, t);
+  return simd::Mul(t, t);
+}
+
+inline simd::Float SquaredDiff(simd::Float a, simd::Float b) {
+  simd::Float d = simd::Sub(a, b);
+  return simd::Mul(d, d);
+}
+
+}  // namespace
+
+void GuideBuffers::SetSize(int width, int height) {
+  albedo.SetSize(width, height);
+  normal.SetSize(width, height);
+  depth.SetSize(width, height);
+  object_id.SetSize(width, height);
+}
+
+void GuideBuffers::Clear() {
+  albedo.Clear(Vec3f(0, 0, 0));
+  normal.Clear(Vec3f(0, 0, 0));
+  depth.Clear(0);
+  object_id.Clear(-1);
+}
+
+void GuideBuffers::Clear(const Tile& region) {
+  albedo.Clear(region, Vec3f(0, 0, 0));
+  normal.Clear(region, Vec3f(0, 0, 0));
+  depth.Clear(region, 0);
+  object_id.Clear(region, -1);
+}
+
+void GuideBuffers::Add(int p, const Scene& scene, int obj,
+                       const TraceResult& hit) {
+  if (obj == kNoObject) {
+    return;
+  }
+  if (object_id[p] < 0) {
+    object_id[p] = obj;
+  }
+  albedo[p] = albedo[p] + scene.Materials().Albedo(scene.MaterialId(obj));
+  normal[p] = normal[p] + hit.normal;
+  depth[p] += hit.t;
+}
+
+Denoiser::Denoiser()
+  : iterations_(0),
+    sigma_color_(kDenoiseSigmaColor),
+    sigma_normal_(kDenoiseSigmaNormal),
+    sigma_depth_(kDenoiseSigmaDepth),
+    sigma_albedo_(kDenoiseSigmaAlbedo) {}
+
+void Denoiser::SetIterations(int iterations) {
+  iterations_ = Clamp(iterations, 0, 10);
+}
+
+void Denoiser::SetSigmas(float color, float normal, float depth,
+                         float albedo) {
+  sigma_color_ = color;
+  sigma_normal_ = normal;
+  sigma_depth_ = depth;
+  sigma_albedo_ = albedo;
+}
+
+void Denoiser::Apply(const Image<Vec3f>& color, const GuideBuffers& guides,
+                     const Image<int>& counts, const Tile& region,
+                     Image<Vec3f>* result) {
+  result->SetSize(color.Width(), color.Height());
+  if (!Enabled()) {
+    for (int y = region.y0; y < region.y1; ++y) {
+      std::copy(&color(region.x0, y), &color(region.x0, y) + region.Width(),
+                &(*result)(region.x0, y));
+    }
+    return;
+  }
+
+  // The pixels of the region depend on the input up to the footprint of all
+  // iterations away, 2 * (2^iterations - 1) pixels. Within that window the
+  // filter runs as if the window was the whole image.
+  int reach = 2 * ((1 << iterations_) - 1);
+  int x0 = std::max(region.x0 - reach, 0);
+  int y0 = std::max(region.y0 - reach, 0);
+  int width = std::min(region.x1 + reach, color.Width()) - x0;
+  int height = std::min(region.y1 + reach, color.Height()) - y0;
+
+  // Every row is padded on both sides so that the taps of a full vector
+  // never leave it, taps outside of the window get a weight of zero.
+  int pad = 2 * (1 << (iterations_ - 1)) + simd::kWidth;
+  int stride = width + 2 * pad;
+  int plane = stride * height;
+  color_[0].assign(3 * plane, 0.0f);
+  color_[1].assign(3 * plane, 0.0f);
+  features_.assign(kNumFeatures * plane, 0.0f);
+
+  // The features are divided by their sigmas once here, so that the sum of
+  // their squared differences is the exponent of the weight.
+  float normal_scale = 1 / std::max(sigma_normal_, 1e-6f);
+  float albedo_scale = 1 / std::max(sigma_albedo_, 1e-6f);
+  ParallelFor(0, height, [&](int y) {
+    for (int x = 0; x < width; ++x) {
+      int p = (x0 + x) + (y0 + y) * color.Width();
+      int q = y * stride + pad + x;
+      float inv_count = counts[p] ? 1.0f / counts[p] : 0.0f;
+      Vec3f n = guides.normal[p] * (inv_count * normal_scale);
+      Vec3f a = guides.albedo[p] * (inv_count * albedo_scale);
+      color_[0][q] = color[p].x;
+      color_[0][plane + q] = color[p].y;
+      color_[0][2 * plane + q] = color[p].z;
+      features_[kNormalX * plane + q] = n.x;
+      features_[kNormalY * plane + q] = n.y;
+      features_[kNormalZ * plane + q] = n.z;
+      features_[kAlbedoX * plane + q] = a.x;
+      features_[kAlbedoY * plane + q] = a.y;
+      features_[kAlbedoZ * plane + q] = a.z;
+      features_[kDepth * plane + q] = guides.depth[p] * inv_count;
+    }
+  });
+
+  const float* f = features_.data();
+  int src = 0;
+  for (int i = 0; i < iterations_; ++i, src ^= 1) {
+    int step = 1 << i;
+    float sigma_color = sigma_color_ / step;
+    simd::Float color_scale = simd::Set(1 / std::max(
+      sigma_color * sigma_color, 1e-12f));
+    const float* in = color_[src].data();
+    float* out = color_[src ^ 1].data();
+
+    ParallelFor(0, height, [&](int y) {
+      for (int x = 0; x < width; x += simd::kWidth) {
+        int c = y * stride + pad + x;
+        simd::Float cx = simd::Ramp(static_cast<float>(x));
+        simd::Float r = simd::Load(in + c);
+        simd::Float g = simd::Load(in + plane + c);
+        simd::Float b = simd::Load(in + 2 * plane + c);
+        simd::Float nx = simd::Load(f + kNormalX * plane + c);
+        simd::Float ny = simd::Load(f + kNormalY * plane + c);
+        simd::Float nz = simd::Load(f + kNormalZ * plane + c);
+        simd::Float ax = simd::Load(f + kAlbedoX * plane + c);
+        simd::Float ay = simd::Load(f + kAlbedoY * plane + c);
+        simd::Float az = simd::Load(f + kAlbedoZ * plane + c);
+        simd::Float z = simd::Load(f + kDepth * plane + c);
+        simd::Float depth_scale = simd::Max(
+          simd::Mul(z, simd::Set(sigma_depth_)), simd::Set(kMinDepth));
+        depth_scale = simd::Div(simd::Set(1.0f),
+                                simd::Mul(depth_scale, depth_scale));
+
+        simd::Float sum_r = simd::Set(0.0f);
+        simd::Float sum_g = simd::Set(0.0f);
+        simd::Float sum_b = simd::Set(0.0f);
+        simd::Float sum_w = simd::Set(0.0f);
+        for (int dy = -2; dy <= 2; ++dy) {
+          int qy = y + dy * step;
+          if (qy < 0 || qy >= height) {
+            continue;
+          }
+          for (int dx = -2; dx <= 2; ++dx) {
+            int q = c + dy * step * stride + dx * step;
+            simd::Float qx = simd::Add(cx, simd::Set(
+              static_cast<float>(dx * step)));
+            simd::Float inside = simd::And(
+              simd::Greater(qx, simd::Set(-1.0f)),
+              simd::Less(qx, simd::Set(static_cast<float>(width))));
+
+            simd::Float qr = simd::Load(in + q);
+            simd::Float qg = simd::Load(in + plane + q);
+            simd::Float qb = simd::Load(in + 2 * plane + q);
+            simd::Float color_dist = simd::Add(
+              simd::Add(SquaredDiff(r, qr), SquaredDiff(g, qg)),
+              SquaredDiff(b, qb));
+            simd::Float dist = simd::Mul(color_dist, color_scale);
+            dist = simd::Add(dist, simd::Add(
+              simd::Add(SquaredDiff(nx, simd::Load(f + kNormalX * plane + q)),
+                        SquaredDiff(ny, simd::Load(f + kNormalY * plane + q))),
+              SquaredDiff(nz, simd::Load(f + kNormalZ * plane + q))));
+            dist = simd::Add(dist, simd::Add(
+              simd::Add(SquaredDiff(ax, simd::Load(f + kAlbedoX * plane + q)),
+                        SquaredDiff(ay, simd::Load(f + kAlbedoY * plane + q))),
+              SquaredDiff(az, simd::Load(f + kAlbedoZ * plane + q))));
+            dist = simd::Add(dist, simd::Mul(
+              SquaredDiff(z, simd::Load(f + kDepth * plane + q)),
+              depth_scale));
+
+            simd::Float w = simd::Mul(
+              ExpNeg(dist), simd::Set(kKernel[dx + 2] * kKernel[dy + 2]));
+            w = simd::And(inside, w);
+            sum_r = simd::Add(sum_r, simd::Mul(w, qr));
+            sum_g = simd::Add(sum_g, simd::Mul(w, qg));
+            sum_b = simd::Add(sum_b, simd::Mul(w, qb));
+            sum_w = simd::Add(sum_w, w);
+          }
+        }
+        // Lanes past the end of the row have no taps inside the image and
+        // only write to the padding.
+        simd::Float inv_w = simd::Div(
+          simd::Set(1.0f), simd::Max(sum_w, simd::Set(1e-12f)));
+        simd::Store(out + c, simd::Mul(sum_r, inv_w));
+        simd::Store(out + plane + c, simd::Mul(sum_g, inv_w));
+        simd::Store(out + 2 * plane + c, simd::Mul(sum_b, inv_w));
+      }
+    });
+  }
+
+  const float* filtered = color_[src].data();
+  ParallelFor(region.y0, region.y1, [&](int y) {
+    for (int x = region.x0; x < region.x1; ++x) {
+      int q = (y - y0) * stride + pad + (x - x0);
+      (*result)(x, y) = Vec3f(filtered[q], filtered[plane + q],
+                              filtered[2 * plane + q]);
+    }
+  });
+}
@@ -0,0 +1,76 @@
+// Copyright 2018, Vahid Kazemi
+
+#ifndef DENOISER_H_
+#define DENOISER_H_
+
+#include <vector>
+
+#include "./geometry.h"
+#include "./image.h"
+#include "./scene.h"
+#include "./tile.h"
+#include "./vec3.h"
+
+// Defaults of the edge stopping parameters, see Denoiser::SetSigmas.
+const float kDenoiseSigmaColor = 0.25f;
+const float kDenoiseSigmaNormal = 0.5f;
+const float kDenoiseSigmaDepth = 0.1f;
+const float kDenoiseSigmaAlbedo = 0.1f;
+
+// Features of the first surface seen through each pixel, which guide the
+// denoiser and are written out as AOVs. Except for the object ids they are
+// summed over the samples of the pixel like the radiance. Rays which miss
+// the scene add nothing.
+struct GuideBuffers {
+  void SetSize(int width, int height);
+  void Clear();
+  void Clear(const Tile& region);
+  // Adds the primary hit of one sample of pixel p, obj is kNoObject on a
+  // miss.
+  void Add(int p, const Scene& scene, int obj, const TraceResult& hit);
+
+  Image<Vec3f> albedo;
+  Image<Vec3f> normal;
+  // Distance from the camera.
+  Image<float> depth;
+  // Scene id of the object hit by the first sample of the pixel
+  // which hit any, -1 if none did.
+  Image<int> object_id;
+};
+
+// Edge avoiding à-trous wavelet filter (Dammertz et al. 2010). Every
+// iteration convolves the image with a 5x5 B3 spline kernel whose taps are
+// spread 2^i pixels apart, and weights each tap by how close its color,
+// normal, depth and albedo are to those of the center pixel.
+class Denoiser {
+ public:
+  Denoiser();
+
+  // Each iteration doubles the footprint of the filter, zero disables it.
+  void SetIterations(int iterations);
+  // Smaller sigmas stop the filter at smaller differences of that feature.
+  // The color sigma is halved after every iteration as the image gets
+  // smoother, depth differences are relative to the depth of the pixel.
+  void SetSigmas(float color, float normal, float depth, float albedo);
+  bool Enabled() const { return iterations_ > 0; }
+
+  // Filters the mean radiance of each pixel, guided by the sums in guides
+  // divided by the sample counts. Only the pixels of result inside region
+  // are written, the work is proportional to the region grown by the
+  // footprint of the filter.
+  void Apply(const Image<Vec3f>& color, const GuideBuffers& guides,
+             const Image<int>& counts, const Tile& region,
+             Image<Vec3f>* result);
+
+ private:
+  int iterations_;
+  float sigma_color_;
+  float sigma_normal_;
+  float sigma_depth_;
+  float sigma_albedo_;
+  // Planar copies of the inputs with padded rows, see Apply.
+  std::vector<float> color_[2];
+  std::vector<float> features_;
+};
+
+#endif  // DENOISER_H_
@@ -0,0 +1,137 @@
+// Copyright 2018, Vahid Kazemi
+
+#define _USE_MATH_DEFINES
+#include <float.h>
+#include <math.h>
+#include <algorithm>
+
+#include "./color.h"
+#include "./environment.h"
+
+namespace {
+
+// Fills cdf with the n + 1 running sums of values scaled to end at 1, or
+// uniform steps if they are all zero. Returns the sum.
+float BuildCdf(const float* values, int n, float* cdf) {
+  cdf[0] = 0;
+  for (int i = 0; i < n; ++i) {
+    cdf[i + 1] = cdf[i] + values[i];
+  }
+  float sum = cdf[n];
+  for (int i = 1; i <= n; ++i) {
+    cdf[i] = sum > 0 ? cdf[i] / sum : static_cast<float>(i) / n;
+  }
+  cdf[n] = 1;
+  return sum;
+}
+
+// Index of the interval of cdf (n + 1 sums) which contains u and the
+// position of u inside it in [0, 1).
+int SampleCdf(const float* cdf, int n, float u, float* offset) {
+  int i = static_cast<int>(std::upper_bound(cdf, cdf + n + 1, u) - cdf) - 1;
+  i = std::max(0, std::min(i, n - 1));
+  // Only reachable for u close to 1, which may land past trailing empty
+  // intervals.
+  while (i > 0 && cdf[i + 1] <= cdf[i]) {
+    --i;
+  }
+  float size = cdf[i + 1] - cdf[i];
+  *offset = size > 0 ? std::min((u - cdf[i]) / size, 1 - FLT_EPSILON) : 0.5f;
+  return i;
+}
+
+}  // namespace
+
+bool Environment::Load(const char* filename) {
+  if (!ReadHdrImage(filename, &image_)) {
+    return false;
+  }
+  int width = image_.Width();
+  int height = image_.Height();
+
+  // Rows near the poles cover a smaller solid angle.
+  weights_.resize(width * height);
+  for (int y = 0; y < height; ++y) {
+    float sin_theta = sinf(static_cast<float>(M_PI) * (y + 0.5f) / height);
+    for (int x = 0; x < width; ++x) {
+      int i = x + y * width;
+      weights_[i] = std::max(Luminance(image_[i]), 0.0f) * sin_theta;
+    }
+  }
+  std::vector<float> row_sums(height);
+  column_cdfs_.resize(height * (width + 1));
+  for (int y = 0; y < height; ++y) {
+    row_sums[y] = BuildCdf(&weights_[y * width], width,
+                           &column_cdfs_[y * (width + 1)]);
+  }
+  row_cdf_.resize(height + 1);
+  total_weight_ = BuildCdf(row_sums.data(), height, row_cdf_.data());
+
+  Hasher hasher;
+  hasher.Add(width);
+  hasher.Add(height);
+  hasher.Add(image_.Data(), width * height * sizeof(Vec3f));
+  hash_ = hasher.Value();
+  return true;
+}
+
+void Environment::Lookup(const Vec3f& direction, int* x, int* y) const {
+  float phi = atan2f(direction.x, -direction.z);
+  float theta = acosf(std::max(-1.0f, std::min(direction.y, 1.0f)));
+  float u = (phi + static_cast<float>(M_PI)) / static_cast<float>(2 * M_PI);
+  float v = theta / static_cast<float>(M_PI);
+  *x = std::max(0, std::min(static_cast<int>(u * image_.Width()),
+                            image_.Width() - 1));
+  *y = std::max(0, std::min(static_cast<int>(v * image_.Height()),
+                            image_.Height() - 1));
+}
+
+Vec3f Environment::Radiance(const Vec3f& direction) const {
+  int x, y;
+  Lookup(direction, &x, &y);
+  return image_(x, y);
+}
+
+bool Environment::Sample(const Vec2f& u, DirectionSample* sample) const {
+  if (!(total_weight_ > 0)) {
+    return false;
+  }
+  int width = image_.Width();
+  int height = image_.Height();
+  float dx, dy;
+  int y = SampleCdf(row_cdf_.data(), height, u.y, &dy);
+  int x = SampleCdf(&column_cdfs_[y * (width + 1)], width, u.x, &dx);
+  float weight = weights_[x + y * width];
+  float theta = static_cast<float>(M_PI) * (y + dy) / height;
+  float phi = static_cast<float>(2 * M_PI) * (x + dx) / width -
+              static_cast<float>(M_PI);
+  float sin_theta = sinf(theta);
+  if (!(weight > 0) || sin_theta <= 0) {
+    return false;
+  }
+  sample->direction = Vec3f(sin_theta * sinf(phi), cosf(theta),
+                            -sin_theta * cosf(phi));
+  sample->distance = FLT_MAX;
+  // The density over the image is constant in each pixel, the mapping to
+  // the sphere stretches it by 2 pi^2 sin(theta).
+  sample->pdf = weight * width * height / total_weight_ /
+                (static_cast<float>(2 * M_PI * M_PI) * sin_theta);
+  return true;
+}
+
+float Environment::Pdf(const Vec3f& direction) const {
+  float sin_theta = sqrtf(std::max(0.0f, 1 - direction.y * direction.y));
+  if (!(total_weight_ > 0) || sin_theta <= 0) {
+    return 0;
+  }
+  int x, y;
+  Lookup(direction, &x, &y);
+  int width = image_.Width();
+  int height = image_.Height();
+  return weights_[x + y * width] * width * height / total_weight_ /
+         (static_cast<float>(2 * M_PI * M_PI) * sin_theta);
+}
+
+void Environment::Hash(Hasher* hasher) const {
+  hasher->Add(hash_);
+}
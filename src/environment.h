@@ -0,0 +1,54 @@
+// Copyright 2018, Vahid Kazemi
+
+#ifndef ENVIRONMENT_H_
+#define ENVIRONMENT_H_
+
+#include <stdint.h>
+#include <vector>
+
+#include "./geometry.h"
+#include "./hash.h"
+#include "./image.h"
+#include "./vec2.h"
+#include "./vec3.h"
+
+// Radiance arriving from infinitely far away, stored as a lat-long image:
+// the top row looks up (+y), the bottom one down and the center of the
+// image towards -z. Directions are sampled in proportion to the luminance
+// they carry so that small bright regions such as the sun are found by
+// shadow rays rather than by chance.
+class Environment {
+ public:
+  Environment() = default;
+
+  // Loads the image and builds the sampling distribution.
+  bool Load(const char* filename);
+
+  Vec3f Radiance(const Vec3f& direction) const;
+
+  // Picks a direction with a density proportional to its luminance. The
+  // distance of the sample is infinite. Returns false if the map is black.
+  bool Sample(const Vec2f& u, DirectionSample* sample) const;
+  // Density per solid angle of Sample choosing direction.
+  float Pdf(const Vec3f& direction) const;
+
+  void Hash(Hasher* hasher) const;
+
+ private:
+  // Pixel seen in direction.
+  void Lookup(const Vec3f& direction, int* x, int* y) const;
+
+  Image<Vec3f> image_;
+  // Piecewise constant density over the image, luminance times the solid
+  // angle of the pixels. Rows are picked from row_cdf_ (height + 1 running
+  // sums from 0 to 1), then a pixel from the width + 1 sums of that row in
+  // column_cdfs_.
+  std::vector<float> row_cdf_;
+  std::vector<float> column_cdfs_;
+  std::vector<float> weights_;
+  float total_weight_ = 0;
+  // Computed once by Load, hashing the pixels for every render is slow.
+  uint64_t hash_ = 0;
+};
+
+#endif  // ENVIRONMENT_H_
@@ -0,0 +1,113 @@
+// Copyright 2018, Vahid Kazemi
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <algorithm>
+
+#include "./framebuffer.h"
+
+TiledFramebuffer::~TiledFramebuffer() {
+  Close();
+}
+
+bool TiledFramebuffer::Open(const char* filename, int width, int height,
+                            int tile_size) {
+  Close();
+  filename_ = filename;
+  width_ = width;
+  height_ = height;
+  tile_size_ = std::max(tile_size, 1);
+  tiles_ = MakeTiles(width, height, tile_size_);
+  tiles_x_ = (width + tile_size_ - 1) / tile_size_;
+  int tiles_y = (height + tile_size_ - 1) / tile_size_;
+  grid_.assign(tiles_x_ * tiles_y, 0);
+  for (size_t t = 0; t < tiles_.size(); ++t) {
+    const Tile& tile = tiles_[t];
+    grid_[tile.y0 / tile_size_ * tiles_x_ + tile.x0 / tile_size_] =
+      static_cast<int>(t);
+  }
+
+  size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  size_t bytes = static_cast<size_t>(tile_size_) * tile_size_ * sizeof(Vec3f);
+  tile_bytes_ = (bytes + page - 1) / page * page;
+  size_ = tile_bytes_ * tiles_.size();
+
+  // The file is sparse until tiles are written, so opening a huge
+  // framebuffer costs no disk space up front.
+  fd_ = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd_ < 0 || ftruncate(fd_, static_cast<off_t>(size_)) != 0) {
+    fprintf(stderr, "Couldn't create framebuffer: %s\n", filename);
+    Close();
+    return false;
+  }
+  void* data = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_,
+                    0);
+  if (data == MAP_FAILED) {
+    fprintf(stderr, "Couldn't map framebuffer: %s\n", filename);
+    Close();
+    return false;
+  }
+  data_ = static_cast<char*>(data);
+  return true;
+}
+
+void TiledFramebuffer::Close() {
+  if (data_) {
+    munmap(data_, size_);
+    data_ = nullptr;
+  }
+  if (fd_ >= 0) {
+    close(fd_);
+    fd_ = -1;
+    remove(filename_.c_str());
+  }
+}
+
+Vec3f* TiledFramebuffer::TileData(int t) {
+  return reinterpret_cast<Vec3f*>(data_ + t * tile_bytes_);
+}
+
+const Vec3f* TiledFramebuffer::TileData(int t) const {
+  return reinterpret_cast<const Vec3f*>(data_ + t * tile_bytes_);
+}
+
+void TiledFramebuffer::Evict(int t) {
+  char* start = data_ + t * tile_bytes_;
+  msync(start, tile_bytes_, MS_ASYNC);
+  madvise(start, tile_bytes_, MADV_DONTNEED);
+}
+
+void TiledFramebuffer::ReadRow(int j, Vec3f* row) const {
+  int ty = j / tile_size_;
+  for (int tx = 0; tx < tiles_x_; ++tx) {
+    int t = grid_[ty * tiles_x_ + tx];
+    const Tile& tile = tiles_[t];
+    const Vec3f* src = TileData(t) + (j - tile.y0) * tile.Width();
+    std::copy(src, src + tile.Width(), row + tile.x0);
+  }
+}
+
+bool TiledFramebuffer::Write(const char* filename, const PostProcess& post) {
+  int strip = -1;
+  auto evict_strip = [this](int ty) {
+    for (int tx = 0; tx < tiles_x_; ++tx) {
+      Evict(grid_[ty * tiles_x_ + tx]);
+    }
+  };
+  bool ok = SaveImageRows(filename, width_, height_,
+                          [&](int j, Vec3f* row) {
+    if (j / tile_size_ != strip) {
+      if (strip >= 0) {
+        evict_strip(strip);
+      }
+      strip = j / tile_size_;
+    }
+    ReadRow(j, row);
+  }, post);
+  if (strip >= 0) {
+    evict_strip(strip);
+  }
+  return ok;
+}
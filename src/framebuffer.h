@@ -0,0 +1,67 @@
+// Copyright 2018, Vahid Kazemi
+
+#ifndef FRAMEBUFFER_H_
+#define FRAMEBUFFER_H_
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+#include "./postprocess.h"
+#include "./tile.h"
+#include "./vec3.h"
+
+// Side of the tiles of a TiledFramebuffer unless another size is given.
+const int kFramebufferTileSize = 64;
+
+// Radiance of an image too large to keep in memory, stored tile by tile in
+// a memory mapped file. The tiles are laid out in the order of MakeTiles,
+// which is also the order the renderer works through them, and each one
+// starts on a page boundary so that it can be written back and dropped from
+// memory on its own once it is finished.
+class TiledFramebuffer {
+ public:
+  TiledFramebuffer() = default;
+  // Unmaps and deletes the backing file.
+  ~TiledFramebuffer();
+
+  bool Open(const char* filename, int width, int height,
+            int tile_size = kFramebufferTileSize);
+  void Close();
+
+  int Width() const { return width_; }
+  int Height() const { return height_; }
+  int TileSize() const { return tile_size_; }
+  const std::vector<Tile>& Tiles() const { return tiles_; }
+
+  // Pixels of tile t row by row, each row as wide as the tile.
+  Vec3f* TileData(int t);
+  const Vec3f* TileData(int t) const;
+  // Starts writing tile t back to the file and releases its memory. The
+  // tile is read back from the file if it is accessed again.
+  void Evict(int t);
+
+  // Copies row j of the image.
+  void ReadRow(int j, Vec3f* row) const;
+
+  // Streams the image to filename, see SaveImageRows. Tiles are evicted
+  // once all of their rows have been written.
+  bool Write(const char* filename, const PostProcess& post);
+
+ private:
+  std::string filename_;
+  int width_ = 0;
+  int height_ = 0;
+  int tile_size_ = 0;
+  std::vector<Tile> tiles_;
+  // Index in tiles_ of each tile, by tile row and column.
+  std::vector<int> grid_;
+  int tiles_x_ = 0;
+  // Bytes between the starts of two tiles in the file.
+  size_t tile_bytes_ = 0;
+  size_t size_ = 0;
+  int fd_ = -1;
+  char* data_ = nullptr;
+};
+
+#endif  // FRAMEBUFFER_H_
@@ -1,7 +1,26 @@
 // Copyright 2018, Vahid Kazemi
 
+#include <algorithm>
+
 #include "./geometry.h"
 #include "./math.h"
+#include "./sampling.h"
+
+bool Geometry::Occluded(const Ray& ray, float start, float end) const {
+  TraceResult result;
+  return Trace(ray, start, end, &result);
+}
+
+bool Geometry::SampleDirection(const Vec3f& /* point */,
+                               const Vec2f& /* u */,
+                               DirectionSample* /* sample */) const {
+  return false;
+}
+
+float Geometry::DirectionPdf(const Vec3f& /* point */,
+                             const Vec3f& /* direction */) const {
+  return 0;
+}
 
 Sphere::Sphere(const Vec3f& center, float radius)
 : center(center), radius(radius) {}
@@ -31,6 +50,88 @@ bool Sphere::Trace(const Ray& ray, float start, float end,
   return true;
 }
 
+bool Sphere::Occluded(const Ray& ray, float start, float end) const {
+  Vec3f v = center - ray.origin;
+  float b = Dot(ray.direction, v);
+  float c = SquaredLength(v) - radius * radius;
+  float d = b * b - c;
+  if (d <= 0) {
+    return false;
+  }
+  float sqrt_d = sqrtf(d);
+  float t0 = b - sqrt_d;
+  float t1 = b + sqrt_d;
+  return (t0 > start && t0 < end) || (t1 > start && t1 < end);
+}
+
+Bounds Sphere::GetBounds() const {
+  Vec3f r(radius, radius, radius);
+  return Bounds(center - r, center + r);
+}
+
+void Sphere::Hash(Hasher* hasher) const {
+  hasher->Add(center);
+  hasher->Add(radius);
+}
+
+float Sphere::Area() const {
+  return static_cast<float>(4 * M_PI) * radius * radius;
+}
+
+namespace {
+
+// 1 - cos of the half angle of the cone in which a sphere is seen from a
+// point at squared distance d2 from its center, zero if the point is inside.
+// Written in terms of the sine to stay accurate for small, distant spheres.
+float ConeSolidAngleFactor(float radius, float d2) {
+  float sin2 = radius * radius / d2;
+  if (sin2 >= 1) {
+    return 0;
+  }
+  return sin2 / (1 + sqrtf(1 - sin2));
+}
+
+}  // namespace
+
+bool SampleSphereDirection(const Vec3f& center, float radius,
+                           const Vec3f& point, const Vec2f& u,
+                           DirectionSample* sample) {
+  Vec3f v = center - point;
+  float d2 = SquaredLength(v);
+  float factor = ConeSolidAngleFactor(radius, d2);
+  if (factor <= 0) {
+    return false;
+  }
+  float d = sqrtf(d2);
+  float cos_theta = 1 - u.x * factor;
+  float sin2_theta = std::max(0.0f, 1 - cos_theta * cos_theta);
+  float sin_theta = sqrtf(sin2_theta);
+  float phi = static_cast<float>(2 * M_PI) * u.y;
+  Vec3f local(sin_theta * cosf(phi), sin_theta * sinf(phi), cos_theta);
+  sample->direction = Normal(ToWorld(local, v / d));
+  sample->distance = d * cos_theta -
+                     sqrtf(std::max(0.0f, radius * radius - d2 * sin2_theta));
+  sample->pdf = 1 / (static_cast<float>(2 * M_PI) * factor);
+  return true;
+}
+
+// Every direction which hits the sphere has the same density.
+float SphereDirectionPdf(const Vec3f& center, float radius,
+                         const Vec3f& point) {
+  float factor = ConeSolidAngleFactor(radius, SquaredLength(center - point));
+  return factor > 0 ? 1 / (static_cast<float>(2 * M_PI) * factor) : 0;
+}
+
+bool Sphere::SampleDirection(const Vec3f& point, const Vec2f& u,
+                             DirectionSample* sample) const {
+  return SampleSphereDirection(center, radius, point, u, sample);
+}
+
+float Sphere::DirectionPdf(const Vec3f& point,
+                           const Vec3f& /* direction */) const {
+  return SphereDirectionPdf(center, radius, point);
+}
+
 Plane::Plane(const Vec3f& normal, float d) : normal(Normal(normal)), d(d) {}
 
 bool Plane::Trace(const Ray& ray, float start, float end,
@@ -50,3 +151,21 @@ bool Plane::Trace(const Ray& ray, float start, float end,
   result->normal = -Sign(dp) * normal;
   return true;
 }
+
+bool Plane::Occluded(const Ray& ray, float start, float end) const {
+  float dp = Dot(normal, ray.direction);
+  if (dp == 0.0f) {
+    return false;
+  }
+  float t = (d - Dot(normal, ray.origin)) / dp;
+  return t > start && t < end;
+}
+
+Bounds Plane::GetBounds() const {
+  return Bounds::Infinite();
+}
+
+void Plane::Hash(Hasher* hasher) const {
+  hasher->Add(normal);
+  hasher->Add(d);
+}
@@ -3,7 +3,10 @@
 #ifndef GEOMETRY_H_
 #define GEOMETRY_H_
 
+#include "./bounds.h"
+#include "./hash.h"
 #include "./ray.h"
+#include "./vec2.h"
 #include "./vec3.h"
 
 struct TraceResult {
@@ -12,12 +15,42 @@ struct TraceResult {
   float t;
 };
 
+// Direction from a point towards a light, see Geometry::SampleDirection.
+struct DirectionSample {
+  Vec3f direction;
+  // Distance to the surface along direction.
+  float distance;
+  // Density per solid angle.
+  float pdf;
+};
+
 class Geometry {
  public:
   virtual ~Geometry() {}
 
   virtual bool Trace(const Ray& ray, float start, float end,
                      TraceResult* result) const = 0;
+  // Whether the ray hits the surface between start and end. Doesn't compute
+  // the hit, overrides stop at the first one they find.
+  virtual bool Occluded(const Ray& ray, float start, float end) const;
+
+  virtual Bounds GetBounds() const = 0;
+
+  // Unbounded geometries are kept out of the scene's acceleration structure.
+  virtual bool Bounded() const { return true; }
+
+  // Adds the parameters which affect the shape to hasher.
+  virtual void Hash(Hasher* hasher) const = 0;
+
+  // Surface area, zero for geometries which can't be sampled as lights.
+  virtual float Area() const { return 0; }
+  // Picks a direction from point towards the surface, used to sample
+  // emissive objects. Returns false if no direction could be chosen.
+  virtual bool SampleDirection(const Vec3f& point, const Vec2f& u,
+                               DirectionSample* sample) const;
+  // Density of SampleDirection choosing direction from point.
+  virtual float DirectionPdf(const Vec3f& point,
+                             const Vec3f& direction) const;
 };
 
 class Sphere : public Geometry {
@@ -26,18 +59,45 @@ class Sphere : public Geometry {
 
   bool Trace(const Ray& ray, float start, float end,
              TraceResult* result) const override;
+  bool Occluded(const Ray& ray, float start, float end) const override;
+
+  Bounds GetBounds() const override;
+  void Hash(Hasher* hasher) const override;
+
+  float Area() const override;
+  // Uniform over the cone of directions in which the sphere is seen.
+  bool SampleDirection(const Vec3f& point, const Vec2f& u,
+                       DirectionSample* sample) const override;
+  float DirectionPdf(const Vec3f& point,
+                     const Vec3f& direction) const override;
+
+  const Vec3f& Center() const { return center; }
+  float Radius() const { return radius; }
 
  private:
   Vec3f center;
   float radius;
 };
 
+// Sphere::SampleDirection and Sphere::DirectionPdf of a sphere given by its
+// center and radius, for spheres which are stored without a Sphere.
+bool SampleSphereDirection(const Vec3f& center, float radius,
+                           const Vec3f& point, const Vec2f& u,
+                           DirectionSample* sample);
+float SphereDirectionPdf(const Vec3f& center, float radius,
+                         const Vec3f& point);
+
 class Plane : public Geometry {
  public:
   Plane(const Vec3f& normal, float d);
 
   bool Trace(const Ray& ray, float start, float end,
              TraceResult* result) const override;
+  bool Occluded(const Ray& ray, float start, float end) const override;
+
+  Bounds GetBounds() const override;
+  bool Bounded() const override { return false; }
+  void Hash(Hasher* hasher) const override;
 
  private:
   Vec3f normal;
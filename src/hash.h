@@ -0,0 +1,41 @@
+// Copyright 2018, Vahid Kazemi
+
+#ifndef HASH_H_
+#define HASH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <type_traits>
+#include <vector>
+
+// Incremental 64 bit FNV-1a hash, used to tell whether the inputs of a
+// render changed. Values are hashed by their bytes.
+class Hasher {
+ public:
+  void Add(const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; ++i) {
+      hash_ = (hash_ ^ bytes[i]) * 0x100000001B3ull;
+    }
+  }
+
+  template<class T>
+  void Add(const T& value) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "Only plain values can be hashed by their bytes.");
+    Add(&value, sizeof(T));
+  }
+
+  template<class T>
+  void Add(const std::vector<T>& values) {
+    Add(values.size());
+    Add(values.data(), values.size() * sizeof(T));
+  }
+
+  uint64_t Value() const { return hash_; }
+
+ private:
+  uint64_t hash_ = 0xCBF29CE484222325ull;
+};
+
+#endif  // HASH_H_
@@ -2,6 +2,9 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <algorithm>
 #include <vector>
 
 #define STB_IMAGE_IMPLEMENTATION
@@ -10,18 +13,144 @@
 #include <stb_image_write.h>
 
 #include "./image.h"
+#include "./postprocess.h"
+
+namespace {
+
+const char* Extension(const char* filename) {
+  const char* dot = strrchr(filename, '.');
+  return dot ? dot + 1 : "";
+}
+
+// Portable float maps store the rows bottom to top.
+bool WritePfm(const char* filename, int width, int height,
+              const RowSource& rows) {
+  FILE* file = fopen(filename, "wb");
+  if (!file) {
+    return false;
+  }
+  // A negative scale marks little endian data.
+  fprintf(file, "PF\n%d %d\n-1.0\n", width, height);
+  std::vector<Vec3f> row(width);
+  for (int j = height - 1; j >= 0; --j) {
+    rows(j, row.data());
+    fwrite(row.data(), sizeof(Vec3f), width, file);
+  }
+  return fclose(file) == 0;
+}
+
+void PutU32(uint32_t v, std::vector<uint8_t>* out) {
+  for (int i = 0; i < 4; ++i) {
+    out->push_back(static_cast<uint8_t>(v >> (8 * i)));
+  }
+}
+
+void PutU64(uint64_t v, std::vector<uint8_t>* out) {
+  PutU32(static_cast<uint32_t>(v), out);
+  PutU32(static_cast<uint32_t>(v >> 32), out);
+}
+
+void PutF32(float v, std::vector<uint8_t>* out) {
+  uint32_t bits;
+  memcpy(&bits, &v, sizeof(bits));
+  PutU32(bits, out);
+}
+
+void PutString(const char* s, std::vector<uint8_t>* out) {
+  out->insert(out->end(), s, s + strlen(s) + 1);
+}
+
+void PutAttribute(const char* name, const char* type, uint32_t size,
+                  std::vector<uint8_t>* out) {
+  PutString(name, out);
+  PutString(type, out);
+  PutU32(size, out);
+}
+
+// Single part scanline OpenEXR file with one line per block and no
+// compression.
+bool WriteExr(const char* filename, int width, int height,
+              const RowSource& rows) {
+  const int kFloat = 2;
+
+  std::vector<uint8_t> header;
+  PutU32(20000630, &header);  // Magic number.
+  PutU32(2, &header);  // Version, single part scanline.
+
+  // Channels must be sorted by name.
+  const char* channels[] = { "B", "G", "R" };
+  PutAttribute("channels", "chlist", 3 * 18 + 1, &header);
+  for (const char* channel : channels) {
+    PutString(channel, &header);
+    PutU32(kFloat, &header);
+    PutU32(0, &header);  // Linear flag and reserved bytes.
+    PutU32(1, &header);  // Sampling.
+    PutU32(1, &header);
+  }
+  header.push_back(0);
+  PutAttribute("compression", "compression", 1, &header);
+  header.push_back(0);
+  for (const char* window : { "dataWindow", "displayWindow" }) {
+    PutAttribute(window, "box2i", 16, &header);
+    PutU32(0, &header);
+    PutU32(0, &header);
+    PutU32(width - 1, &header);
+    PutU32(height - 1, &header);
+  }
+  PutAttribute("lineOrder", "lineOrder", 1, &header);
+  header.push_back(0);
+  PutAttribute("pixelAspectRatio", "float", 4, &header);
+  PutF32(1, &header);
+  PutAttribute("screenWindowCenter", "v2f", 8, &header);
+  PutF32(0, &header);
+  PutF32(0, &header);
+  PutAttribute("screenWindowWidth", "float", 4, &header);
+  PutF32(1, &header);
+  header.push_back(0);
+
+  // Offsets of the lines from the start of the file.
+  uint32_t line_size = 3 * width * sizeof(float);
+  uint64_t offset = header.size() + height * sizeof(uint64_t);
+  for (int j = 0; j < height; ++j) {
+    PutU64(offset, &header);
+    offset += 8 + line_size;
+  }
+
+  FILE* file = fopen(filename, "wb");
+  if (!file) {
+    return false;
+  }
+  fwrite(header.data(), 1, header.size(), file);
+  std::vector<uint8_t> line;
+  std::vector<Vec3f> row(width);
+  for (int j = 0; j < height; ++j) {
+    rows(j, row.data());
+    line.clear();
+    PutU32(j, &line);
+    PutU32(line_size, &line);
+    for (int c = 2; c >= 0; --c) {
+      for (int i = 0; i < width; ++i) {
+        PutF32(row[i].v[c], &line);
+      }
+    }
+    fwrite(line.data(), 1, line.size(), file);
+  }
+  return fclose(file) == 0;
+}
+
+}  // namespace
 
 bool ReadImage(const char* filename, Image<RGBA>* image) {
   int w, h, ch;
   stbi_set_flip_vertically_on_load(1);
   uint8_t *data = stbi_load(filename, &w, &h, &ch, 0);
   if (data == nullptr) {
-    fprintf(stderr, "Image file not found: %s.", filename);
+    fprintf(stderr, "Image file not found: %s.\n", filename);
     return false;
   }
 
   if (ch != 1 && ch != 3 && ch != 4) {
-    fprintf(stderr, "Unsupported image channels: %d", ch);
+    fprintf(stderr, "Unsupported image channels: %d\n", ch);
     return false;
   }
 
@@ -43,11 +172,74 @@ bool ReadImage(const char* filename, Image<RGBA>* image) {
   return true;
 }
 
-bool WriteImage(const char* filename, const Image<RGBA>& image) {
-  stbi_write_jpg(filename, image.Width(), image.Height(), 4, image.Data(), 100);
+bool ReadHdrImage(const char* filename, Image<Vec3f>* image) {
+  int w, h, ch;
+  stbi_set_flip_vertically_on_load(0);
+  float* data = stbi_loadf(filename, &w, &h, &ch, 3);
+  if (data == nullptr) {
+    fprintf(stderr, "Image file not found: %s.\n", filename);
+    return false;
+  }
+  image->SetSize(w, h);
+  const float* p = data;
+  for (int i = 0; i < w * h; ++i, p += 3) {
+    (*image)[i] = Vec3f(p[0], p[1], p[2]);
+  }
+  stbi_image_free(data);
   return true;
 }
 
+bool WriteImage(const char* filename, const Image<RGBA>& image) {
+  // PNG keeps AOVs such as object ids exact, anything else is a JPEG.
+  if (strcasecmp(Extension(filename), "png") == 0) {
+    return stbi_write_png(filename, image.Width(), image.Height(), 4,
+                          image.Data(), image.Width() * 4) != 0;
+  }
+  return stbi_write_jpg(filename, image.Width(), image.Height(), 4,
+                        image.Data(), 100) != 0;
+}
+
+bool IsHdrFilename(const char* filename) {
+  const char* ext = Extension(filename);
+  return strcasecmp(ext, "pfm") == 0 || strcasecmp(ext, "hdr") == 0 ||
+         strcasecmp(ext, "exr") == 0;
+}
+
+bool WriteHdrImage(const char* filename, const Image<Vec3f>& image) {
+  if (strcasecmp(Extension(filename), "hdr") == 0) {
+    return stbi_write_hdr(filename, image.Width(), image.Height(), 3,
+                          image.Data()->v) != 0;
+  }
+  return WriteHdrRows(filename, image.Width(), image.Height(),
+                      [&image](int j, Vec3f* row) {
+    std::copy(&image(0, j), &image(0, j) + image.Width(), row);
+  });
+}
+
+bool WriteHdrRows(const char* filename, int width, int height,
+                  const RowSource& rows) {
+  const char* ext = Extension(filename);
+  if (strcasecmp(ext, "pfm") == 0) {
+    return WritePfm(filename, width, height, rows);
+  } else if (strcasecmp(ext, "exr") == 0) {
+    return WriteExr(filename, width, height, rows);
+  }
+  fprintf(stderr, "Unsupported format for streamed images: %s\n",
+          filename);
+  return false;
+}
+
+bool IsPpmFilename(const char* filename) {
+  return strcasecmp(Extension(filename), "ppm") == 0;
+}
+
+void ConvertToRGBA(const Image<Vec3f>& image, float gamma,
+                   Image<RGBA>* result) {
+  PostProcess post;
+  post.SetGamma(gamma);
+  post.Apply(image, result);
+}
+
 void Mandelbrot(float min_re, float max_re, float min_im, int max_iterations,
                 Image<RGBA>* image) {
   float max_im = min_im + (max_re - min_re) * image->Height() / image->Width();
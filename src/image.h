@@ -3,9 +3,12 @@
 #ifndef IMAGE_H_
 #define IMAGE_H_
 
+#include <algorithm>
+#include <functional>
 #include <vector>
 
 #include "./color.h"
+#include "./tile.h"
 
 template<class T>
 class Image {
@@ -20,6 +23,13 @@ class Image {
     pixels_ = std::move(image.pixels_);
   }
 
+  Image& operator=(Image&& image) {
+    width_ = image.width_;
+    height_ = image.height_;
+    pixels_ = std::move(image.pixels_);
+    return *this;
+  }
+
   void SetSize(int width, int height) {
     width_ = width;
     height_ = height;
@@ -30,6 +40,10 @@ class Image {
     return pixels_[i];
   }
 
+  const T& operator[](int i) const {
+    return pixels_[i];
+  }
+
   const T& operator()(int x, int y) const {
     return pixels_[x + y * width_];
   }
@@ -42,10 +56,22 @@ class Image {
     pixels_.assign(width_ * height_, value);
   }
 
+  // Sets only the pixels inside region.
+  void Clear(const Tile& region, T value) {
+    for (int j = region.y0; j < region.y1; ++j) {
+      T* row = &pixels_[j * width_];
+      std::fill(row + region.x0, row + region.x1, value);
+    }
+  }
+
   const T* Data() const {
     return pixels_.data();
   }
 
+  T* Data() {
+    return pixels_.data();
+  }
+
   int Width() const { return width_; }
   int Height() const { return height_; }
 
@@ -55,8 +81,36 @@ class Image {
 };
 
 bool ReadImage(const char* filename, Image<RGBA>* image);
+// Reads linear radiance with the first row at the top. Radiance .hdr files
+// are read as they are, 8 bit formats are converted from sRGB.
+bool ReadHdrImage(const char* filename, Image<Vec3f>* image);
 bool WriteImage(const char* filename, const Image<RGBA>& image);
 
+// Returns true if filename has the extension of one of the formats supported
+// by WriteHdrImage.
+bool IsHdrFilename(const char* filename);
+// Writes linear radiance without clamping or quantization. The format is
+// picked from the extension: .pfm, .hdr (Radiance RGBE) or .exr (32 bit
+// float, uncompressed).
+bool WriteHdrImage(const char* filename, const Image<Vec3f>& image);
+
+// Fills row with the pixels of row j of an image.
+typedef std::function<void(int j, Vec3f* row)> RowSource;
+
+// Writes an image one row at a time, so that it never has to be in memory
+// as a whole. Each row is requested once, in the order of the file. Only
+// .pfm and .exr are supported.
+bool WriteHdrRows(const char* filename, int width, int height,
+                  const RowSource& rows);
+
+// 8 bit images can be streamed as binary PPM, see SaveImageRows.
+bool IsPpmFilename(const char* filename);
+
+// Gamma corrects linear radiance and quantizes it to 8 bits per channel.
+// See PostProcess for exposure, tonemapping and dithering.
+void ConvertToRGBA(const Image<Vec3f>& image, float gamma,
+                   Image<RGBA>* result);
+
 // ex: min_re = -2, float max_re = 1, min_im = -1.2, max_iterations = 30
 void Mandelbrot(float min_re, float max_re, float min_im, int max_iterations,
                 Image<RGBA>* image);
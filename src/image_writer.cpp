@@ -0,0 +1,103 @@
+// Copyright 2018, Vahid Kazemi
+
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+#include <utility>
+
+#include "./image_writer.h"
+
+ImageWriter::ImageWriter(int max_pending)
+  : max_pending_(std::max(max_pending, 1)), pending_(0), encode_time_(0),
+    stop_(false) {
+  thread_ = std::thread([this]() { WorkerLoop(); });
+}
+
+ImageWriter::~ImageWriter() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  queue_cv_.notify_all();
+  thread_.join();
+}
+
+void ImageWriter::Write(const std::string& filename,
+                        const Image<Vec3f>& image,
+                        const PostProcess& post) {
+  Enqueue(filename, nullptr, post, image);
+}
+
+void ImageWriter::Write(VideoStream* stream, const Image<Vec3f>& image,
+                        const PostProcess& post) {
+  Enqueue("", stream, post, image);
+}
+
+void ImageWriter::Enqueue(const std::string& filename, VideoStream* stream,
+                          const PostProcess& post,
+                          const Image<Vec3f>& image) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_cv_.wait(lock, [this]() { return pending_ < max_pending_; });
+  pending_++;
+  Frame frame;
+  frame.filename = filename;
+  frame.stream = stream;
+  frame.post = post;
+  if (!free_.empty()) {
+    frame.image = std::move(free_.back());
+    free_.pop_back();
+  }
+  lock.unlock();
+
+  frame.image.SetSize(image.Width(), image.Height());
+  std::copy(image.Data(), image.Data() + image.Width() * image.Height(),
+            frame.image.Data());
+
+  lock.lock();
+  queue_.push_back(std::move(frame));
+  lock.unlock();
+  queue_cv_.notify_one();
+}
+
+void ImageWriter::Flush() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_cv_.wait(lock, [this]() { return pending_ == 0; });
+}
+
+double ImageWriter::EncodeTime() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return encode_time_;
+}
+
+void ImageWriter::WorkerLoop() {
+  Image<RGBA> pixels;
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    // Frames still queued are written before stopping.
+    queue_cv_.wait(lock, [this]() { return stop_ || !queue_.empty(); });
+    if (queue_.empty()) {
+      return;
+    }
+    Frame frame = std::move(queue_.front());
+    queue_.pop_front();
+    lock.unlock();
+
+    auto start = std::chrono::steady_clock::now();
+    if (frame.stream) {
+      frame.post.Apply(frame.image, &pixels);
+      if (!frame.stream->WriteFrame(pixels)) {
+        fprintf(stderr, "Couldn't write to the stream.\n");
+      }
+    } else if (!SaveImage(frame.filename.c_str(), frame.image, frame.post)) {
+      fprintf(stderr, "Couldn't write image: %s\n", frame.filename.c_str());
+    }
+    std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+    lock.lock();
+    encode_time_ += elapsed.count();
+    free_.push_back(std::move(frame.image));
+    pending_--;
+    done_cv_.notify_all();
+  }
+}
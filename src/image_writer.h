@@ -0,0 +1,68 @@
+// Copyright 2018, Vahid Kazemi
+
+#ifndef IMAGE_WRITER_H_
+#define IMAGE_WRITER_H_
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "./image.h"
+#include "./postprocess.h"
+#include "./vec3.h"
+#include "./video_stream.h"
+
+// Encodes and writes images on a background thread, so that the next frame
+// is traced while the previous one is compressed. Write copies the image
+// into one of max_pending buffers and returns. It only blocks when all of
+// them are still queued or being written.
+class ImageWriter {
+ public:
+  explicit ImageWriter(int max_pending = 2);
+  // Writes the remaining images.
+  ~ImageWriter();
+
+  // Queues the image to be written with SaveImage.
+  void Write(const std::string& filename, const Image<Vec3f>& image,
+             const PostProcess& post);
+  // Queues the image to be post processed and appended to the stream.
+  // Frames are written in the order they are queued.
+  void Write(VideoStream* stream, const Image<Vec3f>& image,
+             const PostProcess& post);
+
+  // Waits until every queued image has been written.
+  void Flush();
+
+  // Seconds spent encoding and writing images so far.
+  double EncodeTime();
+
+ private:
+  struct Frame {
+    std::string filename;
+    VideoStream* stream;
+    PostProcess post;
+    Image<Vec3f> image;
+  };
+
+  void Enqueue(const std::string& filename, VideoStream* stream,
+               const PostProcess& post, const Image<Vec3f>& image);
+  void WorkerLoop();
+
+  int max_pending_;
+  std::deque<Frame> queue_;
+  // Buffers of frames which have been written, reused by later frames.
+  std::vector<Image<Vec3f>> free_;
+  // Frames queued or being written.
+  int pending_;
+  double encode_time_;
+  bool stop_;
+  std::mutex mutex_;
+  std::condition_variable queue_cv_;
+  std::condition_variable done_cv_;
+  std::thread thread_;
+};
+
+#endif  // IMAGE_WRITER_H_
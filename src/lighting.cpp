@@ -0,0 +1,83 @@
+// Copyright 2018, Vahid Kazemi
+
+#include "./lighting.h"
+
+namespace {
+
+// Distances to the light are shortened by this fraction so that the shadow
+// ray doesn't hit the light itself.
+const float kShadowEpsilon = 1e-3f;
+
+float PowerHeuristic(float a, float b) {
+  return a * a / (a * a + b * b);
+}
+
+}  // namespace
+
+bool SampleLights(const Scene& scene, int obj, const TraceResult& hit,
+                  Sampler* sampler, ShadowRay* shadow) {
+  const MaterialTable& materials = scene.Materials();
+  int material = scene.MaterialId(obj);
+  if (!scene.HasLights() || !materials.Evaluable(material)) {
+    return false;
+  }
+  // All values are drawn up front so that every path uses the same number
+  // of dimensions whatever happens below.
+  float u_light = sampler->Get1D();
+  Vec2f u = sampler->Get2D();
+
+  float probability;
+  int light = scene.SampleLight(u_light, &probability);
+  DirectionSample sample;
+  Vec3f emitted;
+  if (light != kNoObject) {
+    if (!scene.SampleLightDirection(light, hit.position, u, &sample)) {
+      return false;
+    }
+    emitted = materials.Emitted(scene.MaterialId(light));
+  } else {
+    const Environment* environment = scene.GetEnvironment();
+    if (!environment->Sample(u, &sample)) {
+      return false;
+    }
+    emitted = environment->Radiance(sample.direction);
+  }
+  Vec3f f = materials.Evaluate(material, hit, sample.direction);
+  if (f.x <= 0 && f.y <= 0 && f.z <= 0) {
+    return false;
+  }
+  float light_pdf = probability * sample.pdf;
+  float weight = PowerHeuristic(
+    light_pdf, materials.Pdf(material, hit, sample.direction));
+  shadow->ray = Ray(hit.position, sample.direction);
+  shadow->distance = sample.distance * (1 - kShadowEpsilon);
+  shadow->radiance = f * emitted * (weight / light_pdf);
+  return true;
+}
+
+float EmissionWeight(const Scene& scene, const Ray& ray, int obj,
+                     float pdf) {
+  if (pdf <= 0) {
+    return 1;
+  }
+  if (obj == kNoObject) {
+    float light_pdf = scene.EnvironmentProbability();
+    if (light_pdf <= 0) {
+      return 1;
+    }
+    light_pdf *= scene.GetEnvironment()->Pdf(ray.direction);
+    return PowerHeuristic(pdf, light_pdf);
+  }
+  float light_pdf = scene.LightProbability(obj);
+  if (light_pdf <= 0) {
+    return 1;
+  }
+  light_pdf *= scene.LightDirectionPdf(obj, ray.origin);
+  return PowerHeuristic(pdf, light_pdf);
+}
+
+float ScatterPdf(const Scene& scene, int obj, const TraceResult& hit,
+                 const Ray& scattered) {
+  return scene.Materials().Pdf(scene.MaterialId(obj), hit,
+                               scattered.direction);
+}
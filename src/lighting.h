@@ -0,0 +1,46 @@
+// Copyright 2018, Vahid Kazemi
+
+#ifndef LIGHTING_H_
+#define LIGHTING_H_
+
+#include "./geometry.h"
+#include "./ray.h"
+#include "./sampler.h"
+#include "./scene.h"
+#include "./vec3.h"
+
+// Next event estimation, shared by Pathtracer::Shade and Wavefront. At
+// every hit on an evaluable material a light, an emissive object or the
+// environment map, is sampled and a shadow ray traced towards it. Emission
+// is also found by the scattered rays, the two estimates are combined with
+// multiple importance sampling using the power heuristic.
+
+// Shadow ray towards a sampled light.
+struct ShadowRay {
+  Ray ray;
+  // Distance to the light, the light is visible if nothing is closer.
+  float distance;
+  // Radiance reaching the hit through the ray if the light is visible,
+  // times the BSDF and the MIS weight over the density of the sample.
+  Vec3f radiance;
+};
+
+// Samples the lights of the scene from the hit on obj. Draws three
+// values from sampler if the scene has lights and the material of obj is
+// evaluable, none otherwise. Returns false if there is no ray to trace.
+bool SampleLights(const Scene& scene, int obj, const TraceResult& hit,
+                  Sampler* sampler, ShadowRay* shadow);
+
+// MIS weight of the emission of obj, hit by ray which was scattered with
+// density pdf, or of the background if obj is kNoObject. A pdf of zero, for
+// camera rays and materials which aren't evaluable, means the emission
+// could only be found this way.
+float EmissionWeight(const Scene& scene, const Ray& ray, int obj,
+                     float pdf);
+
+// Density of scattering from the hit on obj into scattered, zero if
+// the material isn't evaluable.
+float ScatterPdf(const Scene& scene, int obj, const TraceResult& hit,
+                 const Ray& scattered);
+
+#endif  // LIGHTING_H_
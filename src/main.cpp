@@ -1,8 +1,11 @@
 // Copyright 2018, Vahid Kazemi
 
+#include <stdlib.h>
+#include <string.h>
 #include <functional>
 #include <random>
 
+#include "./concurrency.h"
 #include "./pathtracer.h"
 #include "./script.h"
 
@@ -38,6 +41,7 @@ void SampleScene() {
   Metal material_d(Vec3f(0.9f, 0.9f, 0.9f), 0.0f);
   Object object_d = { &sphere_d, &material_d };
   scene.AddObject(&object_d);
+  scene.Commit();
 
   Vec3f from(4, 1, 2);
   Vec3f to(0, 0, -1);
@@ -45,14 +49,32 @@ void SampleScene() {
   Camera camera(from, to, up, 45, 1.33f, 0.2f, Length(to - from));
 
   Pathtracer pathtracer(640, 480, 64, 10);
-  const Image<RGBA>& image = pathtracer.Render(scene, camera);
+  const Image<Vec3f>& radiance = pathtracer.Render(scene, camera);
 
+  Image<RGBA> image;
+  ConvertToRGBA(radiance, 2.0f, &image);
   WriteImage("output.jpg", image);
 }
 
 int main(int argc, char** argv) {
-  if (argc > 1) {
-    Script().Run(argv[1]);
+  const char* script = nullptr;
+  const char* checkpoint = nullptr;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+      ThreadPool::Default().SetNumThreads(atoi(argv[++i]));
+    } else if (strcmp(argv[i], "--resume") == 0 && i + 1 < argc) {
+      checkpoint = argv[++i];
+    } else {
+      script = argv[i];
+    }
+  }
+
+  if (script) {
+    Script runner;
+    if (checkpoint) {
+      runner.Resume(checkpoint);
+    }
+    runner.Run(script);
   } else {
     SampleScene();
   }
@@ -229,7 +229,7 @@ Mat4<T> operator*(const Mat4<T>& a, const Mat4<T>& b) {
 
 template<class T>
 Mat4<T> operator/(const Mat4<T>& m, const T s) {
-  return m * (1.0 / s);
+  return m * (static_cast<T>(1) / s);
 }
 
 template<class T>
@@ -313,6 +313,31 @@ Mat4<T> Inverse(const Mat4<T>& m) {
     return i / det;
 }
 
+template<class T>
+Vec3<T> TransformPoint(const Mat4<T>& m, const Vec3<T>& p) {
+  return Vec3<T>(
+    m.m11 * p.x + m.m12 * p.y + m.m13 * p.z + m.m14,
+    m.m21 * p.x + m.m22 * p.y + m.m23 * p.z + m.m24,
+    m.m31 * p.x + m.m32 * p.y + m.m33 * p.z + m.m34);
+}
+
+template<class T>
+Vec3<T> TransformVector(const Mat4<T>& m, const Vec3<T>& v) {
+  return Vec3<T>(
+    m.m11 * v.x + m.m12 * v.y + m.m13 * v.z,
+    m.m21 * v.x + m.m22 * v.y + m.m23 * v.z,
+    m.m31 * v.x + m.m32 * v.y + m.m33 * v.z);
+}
+
+// Transforms a normal given the inverse of the transformation matrix.
+template<class T>
+Vec3<T> TransformNormal(const Mat4<T>& inverse, const Vec3<T>& n) {
+  return Vec3<T>(
+    inverse.m11 * n.x + inverse.m21 * n.y + inverse.m31 * n.z,
+    inverse.m12 * n.x + inverse.m22 * n.y + inverse.m32 * n.z,
+    inverse.m13 * n.x + inverse.m23 * n.y + inverse.m33 * n.z);
+}
+
 typedef Mat4<float> Mat4f;
 
 #endif  // MAT4_H_
@@ -1,63 +1,99 @@
 // Copyright 2018, Vahid Kazemi
 
 #include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <algorithm>
 
 #include "./material.h"
 #include "./math.h"
-#include "./rand.h"
+#include "./sampling.h"
 
 Lambertian::Lambertian(const Vec3f& albedo) : albedo_(albedo) {}
 
-bool Lambertian::Scatter(const Ray& ray, const TraceResult& result,
-              Vec3f* attenuation, Ray* scattered) const {
-  Vec3f rnd = Random::PointInUnitSphere();
-  *scattered = Ray(result.position, Normal(result.normal + rnd));
-  *attenuation = albedo_;
-  return true;
+void Lambertian::Hash(Hasher* hasher) const {
+  hasher->Add(Type());
+  hasher->Add(albedo_);
 }
 
 Metal::Metal(const Vec3f& albedo, float fuzz)
   : albedo_(albedo), fuzz_(std::min(fuzz, 0.5f)) {}
 
-bool Metal::Scatter(const Ray& ray, const TraceResult& result,
-                    Vec3f* attenuation, Ray* scattered) const {
+void Metal::Hash(Hasher* hasher) const {
+  hasher->Add(Type());
+  hasher->Add(albedo_);
+  hasher->Add(fuzz_);
+}
+
+Dielectric::Dielectric(float ri) : ri_(ri) {}
+
+void Dielectric::Hash(Hasher* hasher) const {
+  hasher->Add(Type());
+  hasher->Add(ri_);
+}
+
+Emissive::Emissive(const Vec3f& radiance) : radiance_(radiance) {}
+
+void Emissive::Hash(Hasher* hasher) const {
+  hasher->Add(Type());
+  hasher->Add(radiance_);
+}
+
+Vec3f Emissive::Albedo() const {
+  float peak = std::max(radiance_.x, std::max(radiance_.y, radiance_.z));
+  return peak > 0 ? radiance_ / peak : Vec3f(0, 0, 0);
+}
+
+namespace {
+
+bool ScatterLambertian(const Vec3f& albedo, const TraceResult& result,
+                       Sampler* sampler, Vec3f* attenuation,
+                       Ray* scattered) {
+  Vec3f dir = SampleCosineHemisphere(sampler->Get2D());
+  *scattered = Ray(result.position, Normal(ToWorld(dir, result.normal)));
+  *attenuation = albedo;
+  return true;
+}
+
+bool ScatterMetal(const Vec3f& albedo, float fuzz, const Ray& ray,
+                  const TraceResult& result, Sampler* sampler,
+                  Vec3f* attenuation, Ray* scattered) {
   Vec3f reflection = Reflect(ray.direction, result.normal);
-  Vec3f rnd = fuzz_ * Random::PointInUnitSphere();
+  Vec2f u = sampler->Get2D();
+  Vec3f rnd = fuzz * SampleUniformBall(u, sampler->Get1D());
   *scattered = Ray(result.position, Normal(reflection + rnd));
-  *attenuation = albedo_;
+  *attenuation = albedo;
   return Dot(ray.direction, result.normal) < 0;
 }
 
-Dielectric::Dielectric(float ri) : ri_(ri) {}
-
 float schlick(float cosine, float ri) {
   float r0 = Square((1 - ri) / (1 + ri));
   return r0 + (1 - r0) * powf(1 - cosine, 5.f);
 }
 
-bool Dielectric::Scatter(const Ray& ray, const TraceResult& result,
-                         Vec3f* attenuation, Ray* scattered) const {
+bool ScatterDielectric(float ri, const Ray& ray, const TraceResult& result,
+                       Sampler* sampler, Vec3f* attenuation,
+                       Ray* scattered) {
   float ratio;
   float cosine;
   float ddn = Dot(ray.direction, result.normal);
   if (ddn > 0) {
-    ratio = ri_;
-    cosine = sqrtf(1 - ri_ * ri_ * (1 - ddn * ddn));
+    ratio = ri;
+    cosine = sqrtf(1 - ri * ri * (1 - ddn * ddn));
   } else {
-    ratio = 1 / ri_;
+    ratio = 1 / ri;
     cosine = -ddn;
   }
 
   Vec3f refraction;
   float reflect_prob;
   if (Refract(ray.direction, result.normal, ratio, &refraction)) {
-    reflect_prob = schlick(cosine, ri_);
+    reflect_prob = schlick(cosine, ri);
   } else {
     reflect_prob = 1.0f;
   }
 
-  if (Random::Uniform() <= reflect_prob) {
+  if (sampler->Get1D() < reflect_prob) {
     Vec3f reflection = Reflect(ray.direction, result.normal);
     *scattered = Ray(result.position, reflection);
   } else {
@@ -66,3 +102,91 @@ bool Dielectric::Scatter(const Ray& ray, const TraceResult& result,
   *attenuation = Vec3f(1, 1, 1);
   return true;
 }
+
+}  // namespace
+
+void MaterialTable::Clear() {
+  entries_.clear();
+  albedos_.clear();
+  lambertian_.clear();
+  metal_.clear();
+  dielectric_.clear();
+  emissive_.clear();
+}
+
+int MaterialTable::Add(const Material& material) {
+  Entry entry;
+  entry.type = material.Type();
+  switch (entry.type) {
+    case kMaterialLambertian:
+      entry.index = static_cast<int>(lambertian_.size());
+      lambertian_.push_back(material.Albedo());
+      break;
+    case kMaterialMetal: {
+      const Metal& metal = static_cast<const Metal&>(material);
+      entry.index = static_cast<int>(metal_.size());
+      metal_.push_back({metal.Albedo(), metal.Fuzz()});
+      break;
+    }
+    case kMaterialDielectric: {
+      const Dielectric& dielectric = static_cast<const Dielectric&>(material);
+      entry.index = static_cast<int>(dielectric_.size());
+      dielectric_.push_back(dielectric.RefractiveIndex());
+      break;
+    }
+    case kMaterialEmissive:
+      entry.index = static_cast<int>(emissive_.size());
+      emissive_.push_back(material.Emitted());
+      break;
+    default:
+      // A new type needs its parameters and shading code in the table.
+      fprintf(stderr, "Material type %d is missing from MaterialTable.\n",
+              entry.type);
+      abort();
+  }
+  entries_.push_back(entry);
+  albedos_.push_back(material.Albedo());
+  return static_cast<int>(entries_.size()) - 1;
+}
+
+bool MaterialTable::Scatter(int id, const Ray& ray, const TraceResult& result,
+                            Sampler* sampler, Vec3f* attenuation,
+                            Ray* scattered) const {
+  const Entry& entry = entries_[id];
+  switch (entry.type) {
+    case kMaterialLambertian:
+      return ScatterLambertian(lambertian_[entry.index], result, sampler,
+                               attenuation, scattered);
+    case kMaterialMetal: {
+      const MetalParameters& metal = metal_[entry.index];
+      return ScatterMetal(metal.albedo, metal.fuzz, ray, result, sampler,
+                          attenuation, scattered);
+    }
+    case kMaterialDielectric:
+      return ScatterDielectric(dielectric_[entry.index], ray, result, sampler,
+                               attenuation, scattered);
+    default:
+      return false;
+  }
+}
+
+Vec3f MaterialTable::Evaluate(int id, const TraceResult& result,
+                              const Vec3f& direction) const {
+  const Entry& entry = entries_[id];
+  if (entry.type != kMaterialLambertian) {
+    return Vec3f(0, 0, 0);
+  }
+  float cosine = Dot(direction, result.normal);
+  return cosine > 0 ? lambertian_[entry.index] *
+                      static_cast<float>(cosine * M_1_PI)
+                    : Vec3f(0, 0, 0);
+}
+
+float MaterialTable::Pdf(int id, const TraceResult& result,
+                         const Vec3f& direction) const {
+  if (entries_[id].type != kMaterialLambertian) {
+    return 0;
+  }
+  float cosine = Dot(direction, result.normal);
+  return cosine > 0 ? static_cast<float>(cosine * M_1_PI) : 0;
+}
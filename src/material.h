@@ -3,24 +3,49 @@
 #ifndef MATERIAL_H_
 #define MATERIAL_H_
 
+#include <vector>
+
 #include "./geometry.h"
+#include "./hash.h"
 #include "./ray.h"
+#include "./sampler.h"
 #include "./vec3.h"
 
+enum MaterialType {
+  kMaterialLambertian,
+  kMaterialMetal,
+  kMaterialDielectric,
+  kMaterialEmissive,
+  kNumMaterialTypes,
+};
+
+// Description of a material as created by scripts. The renderer doesn't
+// shade with these directly, Scene::Commit copies their parameters into a
+// MaterialTable.
 class Material {
  public:
   virtual ~Material() {}
 
-  virtual bool Scatter(const Ray& ray, const TraceResult& result,
-                       Vec3f* attenuation, Ray* scattered) const = 0;
+  virtual MaterialType Type() const = 0;
+
+  // Adds the type and the parameters of the material to hasher.
+  virtual void Hash(Hasher* hasher) const = 0;
+
+  // Fraction of the incoming light reflected, used to guide the denoiser.
+  virtual Vec3f Albedo() const = 0;
+
+  // Radiance emitted from both sides of the surface.
+  virtual Vec3f Emitted() const { return Vec3f(0, 0, 0); }
 };
 
 class Lambertian : public Material {
  public:
   explicit Lambertian(const Vec3f& albedo);
 
-  bool Scatter(const Ray& ray, const TraceResult& result,
-               Vec3f* attenuation, Ray* scattered) const override;
+  MaterialType Type() const override { return kMaterialLambertian; }
+
+  void Hash(Hasher* hasher) const override;
+  Vec3f Albedo() const override { return albedo_; }
 
  private:
   Vec3f albedo_;
@@ -30,8 +55,11 @@ class Metal : public Material {
  public:
   explicit Metal(const Vec3f& albedo, float fuzz);
 
-  bool Scatter(const Ray& ray, const TraceResult& result,
-               Vec3f* attenuation, Ray* scattered) const override;
+  MaterialType Type() const override { return kMaterialMetal; }
+
+  void Hash(Hasher* hasher) const override;
+  Vec3f Albedo() const override { return albedo_; }
+  float Fuzz() const { return fuzz_; }
 
  private:
   Vec3f albedo_;
@@ -42,11 +70,91 @@ class Dielectric : public Material {
  public:
   explicit Dielectric(float ri);
 
-  bool Scatter(const Ray& ray, const TraceResult& result,
-               Vec3f* attenuation, Ray* scattered) const override;
+  MaterialType Type() const override { return kMaterialDielectric; }
+
+  void Hash(Hasher* hasher) const override;
+  Vec3f Albedo() const override { return Vec3f(1, 1, 1); }
+  float RefractiveIndex() const { return ri_; }
 
  private:
   float ri_;
 };
 
+// Light source which absorbs everything arriving at it.
+class Emissive : public Material {
+ public:
+  explicit Emissive(const Vec3f& radiance);
+
+  MaterialType Type() const override { return kMaterialEmissive; }
+
+  void Hash(Hasher* hasher) const override;
+  // The color of the light, so that the denoiser tells lights apart.
+  Vec3f Albedo() const override;
+  Vec3f Emitted() const override { return radiance_; }
+
+ private:
+  Vec3f radiance_;
+};
+
+// The materials of a committed scene, referred to by integer ids. The
+// parameters are kept in one dense array per type and every method
+// switches on the type of the id, so shading makes no virtual calls.
+class MaterialTable {
+ public:
+  void Clear();
+  // Copies the parameters of material and returns its id.
+  int Add(const Material& material);
+
+  MaterialType Type(int id) const { return entries_[id].type; }
+
+  // Picks the direction the ray continues in after hitting the surface.
+  // Returns false if the ray is absorbed.
+  bool Scatter(int id, const Ray& ray, const TraceResult& result,
+               Sampler* sampler, Vec3f* attenuation, Ray* scattered) const;
+
+  // Fraction of the incoming light reflected, used to guide the denoiser.
+  Vec3f Albedo(int id) const { return albedos_[id]; }
+
+  // Radiance emitted from both sides of the surface.
+  Vec3f Emitted(int id) const {
+    const Entry& entry = entries_[id];
+    return entry.type == kMaterialEmissive ? emissive_[entry.index]
+                                           : Vec3f(0, 0, 0);
+  }
+
+  // Whether Evaluate and Pdf are implemented, which lights need to be
+  // sampled at a hit. Mirror like and glass materials can only be sampled
+  // through Scatter.
+  bool Evaluable(int id) const {
+    return entries_[id].type == kMaterialLambertian;
+  }
+  // BSDF times the cosine of the angle between direction and the normal,
+  // for light arriving along direction at the hit. Both only depend on the
+  // normal, there are no view dependent evaluable materials yet.
+  Vec3f Evaluate(int id, const TraceResult& result,
+                 const Vec3f& direction) const;
+  // Density of Scatter choosing direction, per solid angle.
+  float Pdf(int id, const TraceResult& result, const Vec3f& direction) const;
+
+ private:
+  // Type of a material and its position in the array of that type.
+  struct Entry {
+    MaterialType type;
+    int index;
+  };
+  struct MetalParameters {
+    Vec3f albedo;
+    float fuzz;
+  };
+
+  std::vector<Entry> entries_;
+  std::vector<Vec3f> albedos_;
+  std::vector<Vec3f> lambertian_;
+  std::vector<MetalParameters> metal_;
+  // Refractive indices.
+  std::vector<float> dielectric_;
+  // Radiance.
+  std::vector<Vec3f> emissive_;
+};
+
 #endif  // MATERIAL_H_
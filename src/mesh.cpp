@@ -0,0 +1,224 @@
+// Copyright 2018, Vahid Kazemi
+
+#include <stdio.h>
+#include <string>
+
+#define TINYOBJLOADER_IMPLEMENTATION
+#include <tiny_obj_loader.h>
+
+#include "./mesh.h"
+
+void TriangleSet::Clear() {
+  records_.clear();
+  normals_.clear();
+}
+
+int TriangleSet::Add(const std::vector<Vec3f>& vertices,
+                     const std::vector<Vec3f>& normals,
+                     const std::vector<Triangle>& triangles) {
+  int offset = static_cast<int>(records_.size());
+  int normal_offset = static_cast<int>(normals_.size());
+  normals_.insert(normals_.end(), normals.begin(), normals.end());
+  for (const Triangle& tri : triangles) {
+    Record record;
+    record.p0 = vertices[tri.vertices.x];
+    record.e1 = vertices[tri.vertices.y] - record.p0;
+    record.e2 = vertices[tri.vertices.z] - record.p0;
+    record.normals = tri.normals;
+    if (tri.normals.x >= 0) {
+      record.normals = Vec3i(tri.normals.x + normal_offset,
+                             tri.normals.y + normal_offset,
+                             tri.normals.z + normal_offset);
+    }
+    records_.push_back(record);
+  }
+  return offset;
+}
+
+int TriangleSet::Add(const TriangleSet& other) {
+  int offset = static_cast<int>(records_.size());
+  int normal_offset = static_cast<int>(normals_.size());
+  normals_.insert(normals_.end(), other.normals_.begin(),
+                  other.normals_.end());
+  for (Record record : other.records_) {
+    if (record.normals.x >= 0) {
+      record.normals = Vec3i(record.normals.x + normal_offset,
+                             record.normals.y + normal_offset,
+                             record.normals.z + normal_offset);
+    }
+    records_.push_back(record);
+  }
+  return offset;
+}
+
+float TriangleSet::Intersect(const Ray& ray, int i, float* u,
+                             float* v) const {
+  const Record& tri = records_[i];
+  Vec3f p = Cross(ray.direction, tri.e2);
+  float det = Dot(tri.e1, p);
+  if (det == 0.0f) {
+    return -1.0f;
+  }
+  float inv_det = 1.0f / det;
+  Vec3f s = ray.origin - tri.p0;
+  *u = Dot(s, p) * inv_det;
+  if (*u < 0.0f || *u > 1.0f) {
+    return -1.0f;
+  }
+  Vec3f q = Cross(s, tri.e1);
+  *v = Dot(ray.direction, q) * inv_det;
+  if (*v < 0.0f || *u + *v > 1.0f) {
+    return -1.0f;
+  }
+  return Dot(tri.e2, q) * inv_det;
+}
+
+bool TriangleSet::Trace(const Bvh& bvh, int offset, const Ray& ray,
+                        float start, float end, TraceResult* result) const {
+  int hit = -1;
+  float hit_t = end, hit_u = 0, hit_v = 0;
+  bvh.Traverse(ray, start, end, [&](int first, int count, float* closest) {
+    for (int i = offset + first; i < offset + first + count; ++i) {
+      float u = 0, v = 0;
+      float t = Intersect(ray, i, &u, &v);
+      if (t > start && t < *closest) {
+        *closest = t;
+        hit = i;
+        hit_t = t;
+        hit_u = u;
+        hit_v = v;
+      }
+    }
+  });
+  if (hit < 0) {
+    return false;
+  }
+
+  const Record& tri = records_[hit];
+  Vec3f normal;
+  if (tri.normals.x >= 0) {
+    normal = Normal(normals_[tri.normals.x] * (1 - hit_u - hit_v) +
+                    normals_[tri.normals.y] * hit_u +
+                    normals_[tri.normals.z] * hit_v);
+  } else {
+    normal = Normal(Cross(tri.e1, tri.e2));
+  }
+
+  // Like the other geometries, report the normal facing the ray.
+  if (Dot(normal, ray.direction) > 0) {
+    normal = -normal;
+  }
+
+  result->t = hit_t;
+  result->position = PointAt(ray, hit_t);
+  result->normal = normal;
+  return true;
+}
+
+bool TriangleSet::Occluded(const Bvh& bvh, int offset, const Ray& ray,
+                           float start, float end) const {
+  return bvh.TraverseAny(ray, start, end, [&](int first, int count) {
+    for (int i = offset + first; i < offset + first + count; ++i) {
+      float u, v;
+      float t = Intersect(ray, i, &u, &v);
+      if (t > start && t < end) {
+        return true;
+      }
+    }
+    return false;
+  });
+}
+
+void TriangleMesh::SetData(const std::vector<Vec3f>& vertices,
+                           const std::vector<Vec3f>& normals,
+                           const std::vector<Triangle>& triangles) {
+  std::vector<Bounds> bounds(triangles.size());
+  for (size_t i = 0; i < triangles.size(); ++i) {
+    const Vec3i& v = triangles[i].vertices;
+    bounds[i] = Union(Union(Bounds(), vertices[v.x]), vertices[v.y]);
+    bounds[i] = Union(bounds[i], vertices[v.z]);
+  }
+  bvh_.Build(bounds);
+
+  std::vector<Triangle> ordered(triangles.size());
+  for (size_t i = 0; i < triangles.size(); ++i) {
+    ordered[i] = triangles[bvh_.Primitive(i)];
+  }
+  triangles_.Clear();
+  triangles_.Add(vertices, normals, ordered);
+  num_triangles_ = static_cast<int>(ordered.size());
+
+  Hasher hasher;
+  hasher.Add(vertices);
+  hasher.Add(normals);
+  hasher.Add(ordered);
+  hash_ = hasher.Value();
+}
+
+bool TriangleMesh::Trace(const Ray& ray, float start, float end,
+                         TraceResult* result) const {
+  return triangles_.Trace(bvh_, 0, ray, start, end, result);
+}
+
+bool TriangleMesh::Occluded(const Ray& ray, float start, float end) const {
+  return triangles_.Occluded(bvh_, 0, ray, start, end);
+}
+
+Bounds TriangleMesh::GetBounds() const {
+  return bvh_.GetBounds();
+}
+
+void TriangleMesh::Hash(Hasher* hasher) const {
+  hasher->Add(hash_);
+}
+
+bool ReadMesh(const char* filename, TriangleMesh* mesh) {
+  tinyobj::attrib_t attrib;
+  std::vector<tinyobj::shape_t> shapes;
+  std::vector<tinyobj::material_t> materials;
+  std::string err;
+  if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &err, filename)) {
+    fprintf(stderr, "Failed to load mesh %s: %s\n", filename, err.c_str());
+    return false;
+  }
+
+  std::vector<Vec3f> vertices(attrib.vertices.size() / 3);
+  for (size_t i = 0; i < vertices.size(); ++i) {
+    vertices[i] = Vec3f(attrib.vertices[3 * i],
+                        attrib.vertices[3 * i + 1],
+                        attrib.vertices[3 * i + 2]);
+  }
+
+  std::vector<Vec3f> normals(attrib.normals.size() / 3);
+  for (size_t i = 0; i < normals.size(); ++i) {
+    normals[i] = Vec3f(attrib.normals[3 * i],
+                       attrib.normals[3 * i + 1],
+                       attrib.normals[3 * i + 2]);
+  }
+
+  // Faces are triangulated by the loader.
+  std::vector<Triangle> triangles;
+  for (const tinyobj::shape_t& shape : shapes) {
+    const std::vector<tinyobj::index_t>& indices = shape.mesh.indices;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+      Vec3i v(indices[i].vertex_index,
+              indices[i + 1].vertex_index,
+              indices[i + 2].vertex_index);
+      Vec3i n(indices[i].normal_index,
+              indices[i + 1].normal_index,
+              indices[i + 2].normal_index);
+      if (n.x < 0 || n.y < 0 || n.z < 0) {
+        n = Vec3i(-1, -1, -1);
+      }
+      triangles.emplace_back(v, n);
+    }
+  }
+
+  if (triangles.empty()) {
+    fprintf(stderr, "Mesh has no faces: %s\n", filename);
+    return false;
+  }
+
+  mesh->SetData(vertices, normals, triangles);
+  return true;
+}
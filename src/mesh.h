@@ -0,0 +1,95 @@
+// Copyright 2018, Vahid Kazemi
+
+#ifndef MESH_H_
+#define MESH_H_
+
+#include <stdint.h>
+#include <vector>
+
+#include "./bvh.h"
+#include "./geometry.h"
+#include "./vec3.h"
+
+struct Triangle {
+  Triangle() = default;
+  Triangle(const Vec3i& vertices, const Vec3i& normals)
+  : vertices(vertices), normals(normals) {}
+
+  // Indices into the vertex buffer of the mesh.
+  Vec3i vertices;
+  // Indices into the normal buffer, negative if the face has no normals.
+  Vec3i normals;
+};
+
+// Triangles copied out of their meshes into one array, with the vertices
+// and edges each one needs stored next to each other. A mesh is traced
+// through its own bvh, whose leaves index its triangles starting at the
+// offset returned by Add.
+class TriangleSet {
+ public:
+  void Clear();
+  // Appends the triangles, which index into vertices and normals, and
+  // returns the index of the first one.
+  int Add(const std::vector<Vec3f>& vertices,
+          const std::vector<Vec3f>& normals,
+          const std::vector<Triangle>& triangles);
+  // Appends the triangles of another set.
+  int Add(const TriangleSet& other);
+
+  bool Trace(const Bvh& bvh, int offset, const Ray& ray, float start,
+             float end, TraceResult* result) const;
+  bool Occluded(const Bvh& bvh, int offset, const Ray& ray, float start,
+                float end) const;
+
+ private:
+  struct Record {
+    Vec3f p0;
+    Vec3f e1;
+    Vec3f e2;
+    // Indices into normals_, negative if the face has no normals.
+    Vec3i normals;
+  };
+
+  // Returns the distance to triangle i and the barycentric coordinates of
+  // the hit point or a negative value if the ray misses it.
+  float Intersect(const Ray& ray, int i, float* u, float* v) const;
+
+  std::vector<Record> records_;
+  std::vector<Vec3f> normals_;
+};
+
+// Indexed triangle mesh with its own bvh, traced as a single object.
+class TriangleMesh : public Geometry {
+ public:
+  TriangleMesh() = default;
+
+  // Replaces the mesh data and rebuilds the acceleration structure.
+  void SetData(const std::vector<Vec3f>& vertices,
+               const std::vector<Vec3f>& normals,
+               const std::vector<Triangle>& triangles);
+
+  bool Trace(const Ray& ray, float start, float end,
+             TraceResult* result) const override;
+  bool Occluded(const Ray& ray, float start, float end) const override;
+
+  Bounds GetBounds() const override;
+  void Hash(Hasher* hasher) const override;
+
+  int NumTriangles() const { return num_triangles_; }
+
+  // Used by Scene::Commit to copy the triangles into the scene.
+  const Bvh& GetBvh() const { return bvh_; }
+  const TriangleSet& Triangles() const { return triangles_; }
+
+ private:
+  // Stored in the order of the bvh leaves.
+  TriangleSet triangles_;
+  int num_triangles_ = 0;
+  Bvh bvh_;
+  // Hash of the mesh data, computed once by SetData.
+  uint64_t hash_ = 0;
+};
+
+bool ReadMesh(const char* filename, TriangleMesh* mesh);
+
+#endif  // MESH_H_
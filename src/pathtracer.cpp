@@ -1,19 +1,150 @@
 // Copyright 2018, Vahid Kazemi
 
 #include <float.h>
-#include <random>
+#include <limits.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 
+#include "./color.h"
 #include "./concurrency.h"
-#include "./rand.h"
+#include "./hash.h"
+#include "./lighting.h"
+#include "./math.h"
 #include "./pathtracer.h"
+#include "./rand.h"
+#include "./tile.h"
+#include "./wavefront.h"
+
+namespace {
+
+// Size of the square blocks of pixels handed out to the workers. Matches
+// the largest packet so that packets never straddle two tiles.
+const int kTileSize = RayPacket::kMaxSize;
+
+// Number of paths advanced together by each wavefront.
+const int kWavefrontSize = 1 << 16;
+
+// Identifies checkpoint files and their layout version.
+const char kCheckpointMagic[8] = { 'P', 'T', 'C', 'K', 'P', 'T', '0', '3' };
+
+// Followed by the accumulation buffer, the sample counts, the squared
+// luminance sums and the albedo, normal, depth and object id guide buffers,
+// in pixel order.
+struct CheckpointHeader {
+  char magic[8];
+  int32_t width;
+  int32_t height;
+  int32_t next_sample;
+  int32_t num_passes;
+  uint64_t state_hash;
+};
+
+// Running mean and variance of the samples of a pixel. The variance is
+// tracked on luminance with Welford's algorithm.
+class PixelStats {
+ public:
+  void Add(const Vec3f& color) {
+    sum_ = sum_ + color;
+    count_++;
+    float y = Luminance(color);
+    squares_ += y * y;
+    float delta = y - mean_;
+    mean_ += delta / count_;
+    m2_ += delta * (y - mean_);
+  }
+
+  const Vec3f& Sum() const { return sum_; }
+  float Squares() const { return squares_; }
+  int Count() const { return count_; }
+
+  // Standard error of the mean luminance relative to the mean.
+  float RelativeError() const {
+    if (count_ < 2) {
+      return FLT_MAX;
+    }
+    float variance = m2_ / (count_ - 1);
+    return sqrtf(variance / count_) / (mean_ + kErrorEpsilon);
+  }
+
+ private:
+  // Keeps dark pixels from demanding an unbounded number of samples.
+  static constexpr float kErrorEpsilon = 0.01f;
+
+  Vec3f sum_ = Vec3f(0, 0, 0);
+  float mean_ = 0;
+  float m2_ = 0;
+  float squares_ = 0;
+  int count_ = 0;
+};
+
+}  // namespace
 
 Pathtracer::Pathtracer(int width, int height, int num_samples, int max_depth) :
   num_samples_(num_samples),
   max_depth_(max_depth),
-  image_(width, height) {}
+  roulette_depth_(kRouletteMinDepth),
+  roulette_threshold_(kRouletteThreshold),
+  packet_size_(1),
+  integrator_(kIntegratorRecursive),
+  sampler_(kSamplerSobol),
+  seed_(0),
+  adaptive_(false),
+  min_samples_(num_samples),
+  max_samples_(num_samples),
+  threshold_(0),
+  progressive_(false),
+  pass_samples_(0),
+  progressive_samples_(0),
+  time_budget_(0),
+  checkpoint_interval_(60),
+  next_sample_(0),
+  state_hash_(0),
+  num_passes_(0),
+  width_(width),
+  height_(height),
+  region_(0, 0, 0, 0),
+  denoised_valid_(false) {}
 
 void Pathtracer::SetSize(int width, int height) {
-  image_.SetSize(width, height);
+  width_ = width;
+  height_ = height;
+}
+
+void Pathtracer::SetRegion(int x0, int y0, int x1, int y1) {
+  region_ = Tile(x0, y0, x1, y1);
+}
+
+Tile Pathtracer::Region() const {
+  Tile region(std::max(region_.x0, 0), std::max(region_.y0, 0),
+              std::min(region_.x1, width_), std::min(region_.y1, height_));
+  if (region.x1 <= region.x0 || region.y1 <= region.y0) {
+    return Tile(0, 0, width_, height_);
+  }
+  return region;
+}
+
+void Pathtracer::Allocate() {
+  if (image_.Width() == width_ && image_.Height() == height_) {
+    return;
+  }
+  // SetSize keeps the old pixels, which no longer line up with the new
+  // layout and would show outside of a region.
+  accumulation_.SetSize(width_, height_);
+  accumulation_.Clear(Vec3f(0, 0, 0));
+  sample_counts_.SetSize(width_, height_);
+  sample_counts_.Clear(0);
+  luminance_squares_.SetSize(width_, height_);
+  luminance_squares_.Clear(0);
+  guides_.SetSize(width_, height_);
+  guides_.Clear();
+  image_.SetSize(width_, height_);
+  image_.Clear(Vec3f(0, 0, 0));
+  denoised_valid_ = false;
 }
 
 void Pathtracer::SetSamples(int num_samples) {
@@ -24,41 +155,543 @@ void Pathtracer::SetMaxDepth(int max_depth) {
   max_depth_ = max_depth;
 }
 
-Vec3f Pathtracer::Trace(const Scene& scene, const Ray& ray, int depth) const {
+void Pathtracer::SetRoulette(int min_depth, float threshold) {
+  roulette_depth_ = min_depth;
+  roulette_threshold_ = std::max(threshold, 1e-6f);
+}
+
+void Pathtracer::SetPacketSize(int packet_size) {
+  packet_size_ = Clamp(packet_size, 1, static_cast<int>(RayPacket::kMaxSize));
+}
+
+void Pathtracer::SetIntegrator(Integrator integrator) {
+  integrator_ = integrator;
+}
+
+void Pathtracer::SetSampler(SamplerType sampler) {
+  sampler_ = sampler;
+}
+
+void Pathtracer::SetSeed(uint32_t seed) {
+  seed_ = seed;
+}
+
+void Pathtracer::SetAdaptive(int min_samples, int max_samples,
+                             float threshold) {
+  min_samples_ = std::max(min_samples, 1);
+  max_samples_ = std::max(max_samples, min_samples_);
+  threshold_ = threshold;
+  adaptive_ = threshold > 0;
+}
+
+void Pathtracer::SetProgressive(int pass_samples, int max_samples,
+                                double time_budget) {
+  progressive_ = pass_samples > 0;
+  pass_samples_ = pass_samples;
+  progressive_samples_ = std::max(max_samples, 0);
+  time_budget_ = std::max(time_budget, 0.0);
+}
+
+void Pathtracer::SetCheckpoint(const std::string& filename,
+                               double interval) {
+  checkpoint_file_ = filename;
+  checkpoint_interval_ = interval;
+}
+
+void Pathtracer::SetDenoise(int iterations, float sigma_color,
+                            float sigma_normal, float sigma_depth,
+                            float sigma_albedo) {
+  denoiser_.SetIterations(iterations);
+  denoiser_.SetSigmas(sigma_color, sigma_normal, sigma_depth, sigma_albedo);
+}
+
+bool Pathtracer::SaveCheckpoint(const char* filename) const {
+  // Write to a temporary file first so that a process killed while writing
+  // leaves the previous checkpoint intact.
+  std::string temp = std::string(filename) + ".tmp";
+  FILE* file = fopen(temp.c_str(), "wb");
+  if (!file) {
+    fprintf(stderr, "Couldn't write checkpoint: %s\n", temp.c_str());
+    return false;
+  }
+  CheckpointHeader header;
+  memcpy(header.magic, kCheckpointMagic, sizeof(header.magic));
+  header.width = image_.Width();
+  header.height = image_.Height();
+  header.next_sample = next_sample_;
+  header.num_passes = num_passes_;
+  header.state_hash = state_hash_;
+  int num_pixels = header.width * header.height;
+  fwrite(&header, sizeof(header), 1, file);
+  fwrite(accumulation_.Data(), sizeof(Vec3f), num_pixels, file);
+  fwrite(sample_counts_.Data(), sizeof(int), num_pixels, file);
+  fwrite(luminance_squares_.Data(), sizeof(float), num_pixels, file);
+  fwrite(guides_.albedo.Data(), sizeof(Vec3f), num_pixels, file);
+  fwrite(guides_.normal.Data(), sizeof(Vec3f), num_pixels, file);
+  fwrite(guides_.depth.Data(), sizeof(float), num_pixels, file);
+  fwrite(guides_.object_id.Data(), sizeof(int), num_pixels, file);
+  bool ok = !ferror(file);
+  ok = fclose(file) == 0 && ok;
+  if (!ok || rename(temp.c_str(), filename) != 0) {
+    fprintf(stderr, "Couldn't write checkpoint: %s\n", filename);
+    remove(temp.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool Pathtracer::LoadCheckpoint(const char* filename) {
+  FILE* file = fopen(filename, "rb");
+  if (!file) {
+    fprintf(stderr, "Checkpoint not found: %s\n", filename);
+    return false;
+  }
+  CheckpointHeader header;
+  if (fread(&header, sizeof(header), 1, file) != 1 ||
+      memcmp(header.magic, kCheckpointMagic, sizeof(header.magic)) != 0 ||
+      header.width <= 0 || header.height <= 0) {
+    fprintf(stderr, "Invalid checkpoint: %s\n", filename);
+    fclose(file);
+    return false;
+  }
+  int num_pixels = header.width * header.height;
+  Image<Vec3f> accumulation(header.width, header.height);
+  Image<int> sample_counts(header.width, header.height);
+  Image<float> luminance_squares(header.width, header.height);
+  GuideBuffers guides;
+  guides.SetSize(header.width, header.height);
+  size_t n = static_cast<size_t>(num_pixels);
+  bool ok =
+    fread(accumulation.Data(), sizeof(Vec3f), n, file) == n &&
+    fread(sample_counts.Data(), sizeof(int), n, file) == n &&
+    fread(luminance_squares.Data(), sizeof(float), n, file) == n &&
+    fread(guides.albedo.Data(), sizeof(Vec3f), n, file) == n &&
+    fread(guides.normal.Data(), sizeof(Vec3f), n, file) == n &&
+    fread(guides.depth.Data(), sizeof(float), n, file) == n &&
+    fread(guides.object_id.Data(), sizeof(int), n, file) == n;
+  fclose(file);
+  if (!ok) {
+    fprintf(stderr, "Truncated checkpoint: %s\n", filename);
+    return false;
+  }
+
+  SetSize(header.width, header.height);
+  Allocate();
+  accumulation_ = std::move(accumulation);
+  sample_counts_ = std::move(sample_counts);
+  luminance_squares_ = std::move(luminance_squares);
+  guides_ = std::move(guides);
+  next_sample_ = header.next_sample;
+  num_passes_ = header.num_passes;
+  state_hash_ = header.state_hash;
+  Resolve(Tile(0, 0, width_, height_));
+  return true;
+}
+
+void Pathtracer::GetAov(Aov aov, bool display, Image<Vec3f>* image) const {
+  int num_pixels = image_.Width() * image_.Height();
+  image->SetSize(image_.Width(), image_.Height());
+  for (int p = 0; p < num_pixels; ++p) {
+    int count = sample_counts_[p];
+    float inv_count = count ? 1.0f / count : 0.0f;
+    Vec3f value;
+    switch (aov) {
+      case kAovNormal:
+        value = guides_.normal[p] * inv_count;
+        if (display) {
+          value = NormalToColor(value);
+        }
+        break;
+      case kAovDepth: {
+        float depth = guides_.depth[p] * inv_count;
+        value = Vec3f(depth, depth, depth);
+        break;
+      }
+      case kAovAlbedo:
+        value = guides_.albedo[p] * inv_count;
+        break;
+      case kAovObjectId: {
+        int id = guides_.object_id[p];
+        if (!display) {
+          value = Vec3f(id, id, id);
+        } else if (id < 0) {
+          value = Vec3f(0, 0, 0);
+        } else {
+          uint32_t h = Hash(static_cast<uint32_t>(id));
+          value = Vec3f(h & 0xff, (h >> 8) & 0xff, (h >> 16) & 0xff) / 255.0f;
+        }
+        break;
+      }
+      case kAovSampleCount:
+        value = Vec3f(count, count, count);
+        break;
+      case kAovVariance: {
+        float variance = 0;
+        if (count > 1) {
+          float mean = Luminance(accumulation_[p]) * inv_count;
+          variance = std::max(luminance_squares_[p] * inv_count -
+                              mean * mean, 0.0f) * count / (count - 1);
+        }
+        if (display) {
+          variance /= 1 + variance;
+        }
+        value = Vec3f(variance, variance, variance);
+        break;
+      }
+    }
+    (*image)[p] = value;
+  }
+
+  if (display && (aov == kAovDepth || aov == kAovSampleCount)) {
+    float max_value = 0;
+    for (int p = 0; p < num_pixels; ++p) {
+      max_value = std::max(max_value, (*image)[p].x);
+    }
+    if (max_value > 0) {
+      for (int p = 0; p < num_pixels; ++p) {
+        (*image)[p] = (*image)[p] / max_value;
+      }
+    }
+  }
+}
+
+float Pathtracer::AverageSamples() const {
+  int num_pixels = image_.Width() * image_.Height();
+  int64_t total_samples = 0;
+  for (int p = 0; p < num_pixels; ++p) {
+    total_samples += sample_counts_[p];
+  }
+  return num_pixels ? static_cast<float>(total_samples) / num_pixels : 0;
+}
+
+Vec3f Pathtracer::Trace(const Scene& scene, const Ray& ray, Sampler* sampler,
+                        int depth) const {
   TraceResult result;
-  const Object* obj = scene.Trace(ray, 0.001, FLT_MAX, &result);
+  int obj = scene.Trace(ray, 0.001, FLT_MAX, &result);
+  return Shade(scene, ray, obj, result, sampler, depth);
+}
 
-  if (obj) {
+Vec3f Pathtracer::Shade(const Scene& scene, const Ray& ray, int obj,
+                        const TraceResult& result, Sampler* sampler,
+                        int depth) const {
+  const MaterialTable& materials = scene.Materials();
+  Vec3f radiance(0, 0, 0);
+  Vec3f throughput(1, 1, 1);
+  Ray current = ray;
+  TraceResult hit = result;
+  // Density of the scatter which led to the current ray, zero for camera
+  // rays, see EmissionWeight.
+  float pdf = 0;
+  for (;; ++depth) {
+    if (obj == kNoObject) {
+      return radiance + throughput * scene.Background(current) *
+             EmissionWeight(scene, current, kNoObject, pdf);
+    }
+    int material = scene.MaterialId(obj);
+    Vec3f emitted = materials.Emitted(material);
+    if (emitted.x > 0 || emitted.y > 0 || emitted.z > 0) {
+      radiance = radiance + throughput * emitted *
+                 EmissionWeight(scene, current, obj, pdf);
+    }
     Vec3f attenuation;
     Ray scattered;
-    if (depth < max_depth_ &&
-        obj->material->Scatter(ray, result, &attenuation, &scattered)) {
-      Vec3f ref_color = Trace(scene, scattered, depth + 1);
-      return ref_color * attenuation;
-    } else {
-      return Vec3f(0, 0, 0);
-    }
-  } else {
-    float t = (ray.direction.y + 1) * 0.5;
-    return Lerp(Vec3f(1, 1, 1), Vec3f(0.3, 0.74, 1.0), t);
-  }
-}
-
-const Image<RGBA>& Pathtracer::Render(const Scene& scene, const Camera& camera) {
-  float inv_width = 1.0f / image_.Width();
-  float inv_height = 1.0f / image_.Height();
-  ParallelFor(0, image_.Height(), [&](int j){
-    for (int i = 0; i < image_.Width(); ++i) {
-      Vec3f color(0, 0, 0);
-      for (int k = 0; k < num_samples_; ++k) {
-        Ray ray = camera.GetRay(
-          (i + Random::Uniform()) * inv_width,
-          1 - (j + Random::Uniform()) * inv_height);
-        color = color + Trace(scene, ray, 0);
+    if (depth >= max_depth_ ||
+        !materials.Scatter(material, current, hit, sampler, &attenuation,
+                           &scattered)) {
+      return radiance;
+    }
+    ShadowRay shadow;
+    if (SampleLights(scene, obj, hit, sampler, &shadow)) {
+      if (!scene.Occluded(shadow.ray, 0.001, shadow.distance)) {
+        radiance = radiance + throughput * shadow.radiance;
+      }
+    }
+    pdf = ScatterPdf(scene, obj, hit, scattered);
+    throughput = throughput * attenuation;
+    if (depth + 1 >= roulette_depth_ &&
+        !SurvivesRoulette(roulette_threshold_, &throughput, sampler)) {
+      return radiance;
+    }
+    current = scattered;
+    obj = scene.Trace(current, 0.001, FLT_MAX, &hit);
+  }
+}
+
+const Image<Vec3f>& Pathtracer::Render(const Scene& scene,
+                                       const Camera& camera,
+                                       const PassCallback& on_pass) {
+  Allocate();
+  int pass_samples = num_samples_;
+  int max_samples = num_samples_;
+  double time_budget = 0;
+  if (progressive_) {
+    pass_samples = pass_samples_;
+    time_budget = time_budget_;
+    if (progressive_samples_ > 0) {
+      max_samples = progressive_samples_;
+    } else if (time_budget > 0) {
+      max_samples = INT_MAX;
+    }
+  } else if (adaptive_) {
+    pass_samples = max_samples = max_samples_;
+  }
+
+  // Progressive renders resume from the accumulated samples as long as
+  // nothing they depend on has changed.
+  Tile region = Region();
+  uint64_t state_hash = StateHash(scene, camera);
+  if (!progressive_ || state_hash != state_hash_) {
+    accumulation_.Clear(region, Vec3f(0, 0, 0));
+    sample_counts_.Clear(region, 0);
+    luminance_squares_.Clear(region, 0);
+    guides_.Clear(region);
+    next_sample_ = 0;
+    num_passes_ = 0;
+    state_hash_ = state_hash;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  auto last_checkpoint = start;
+  double pass_time = 0;
+  while (next_sample_ < max_samples) {
+    if (time_budget > 0) {
+      // Don't start a pass which is expected to overrun the budget.
+      std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+      if (elapsed.count() + pass_time > time_budget) {
+        break;
+      }
+    }
+    auto pass_start = std::chrono::steady_clock::now();
+    int num_samples = std::min(pass_samples, max_samples - next_sample_);
+    RenderPass(scene, camera, region, next_sample_, num_samples);
+    next_sample_ += num_samples;
+    num_passes_++;
+    pass_time = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - pass_start).count();
+    if (on_pass) {
+      Resolve(region);
+      on_pass(num_passes_, Output());
+    }
+    if (!checkpoint_file_.empty() &&
+        std::chrono::duration<double>(std::chrono::steady_clock::now() -
+          last_checkpoint).count() >= checkpoint_interval_) {
+      SaveCheckpoint(checkpoint_file_.c_str());
+      last_checkpoint = std::chrono::steady_clock::now();
+    }
+  }
+  if (!checkpoint_file_.empty()) {
+    SaveCheckpoint(checkpoint_file_.c_str());
+  }
+  Resolve(region);
+  return Output();
+}
+
+uint64_t Pathtracer::StateHash(const Scene& scene,
+                               const Camera& camera) const {
+  Hasher hasher;
+  scene.Hash(&hasher);
+  camera.Hash(&hasher);
+  hasher.Add(width_);
+  hasher.Add(height_);
+  Tile region = Region();
+  hasher.Add(region.x0);
+  hasher.Add(region.y0);
+  hasher.Add(region.x1);
+  hasher.Add(region.y1);
+  hasher.Add(max_depth_);
+  hasher.Add(roulette_depth_);
+  hasher.Add(roulette_threshold_);
+  hasher.Add(sampler_);
+  hasher.Add(seed_);
+  hasher.Add(pass_samples_);
+  return hasher.Value();
+}
+
+std::unique_ptr<Sampler> Pathtracer::NewSampler(int num_samples) const {
+  // The last pass may be shorter, the strata have to stay the same.
+  return CreateSampler(sampler_, progressive_ ? pass_samples_ : num_samples,
+                       seed_);
+}
+
+void Pathtracer::RenderPass(const Scene& scene, const Camera& camera,
+                            const Tile& region, int first_sample,
+                            int num_samples) {
+  if (integrator_ == kIntegratorWavefront) {
+    RenderWavefront(scene, camera, region, first_sample, num_samples);
+    return;
+  }
+  std::vector<Tile> tiles = MakeTiles(region.Width(), region.Height(),
+                                      kTileSize);
+  for (Tile& tile : tiles) {
+    tile = Tile(tile.x0 + region.x0, tile.y0 + region.y0,
+                tile.x1 + region.x0, tile.y1 + region.y0);
+  }
+  TileBuffers buffers = {&accumulation_(0, 0), &sample_counts_(0, 0),
+                         &luminance_squares_(0, 0), &guides_, 0, 0,
+                         image_.Width()};
+  ParallelFor(0, static_cast<int>(tiles.size()), [&](int t) {
+    RenderTile(scene, camera, tiles[t], first_sample, num_samples, buffers);
+  });
+}
+
+float Pathtracer::RenderTiled(const Scene& scene, const Camera& camera,
+                              TiledFramebuffer* framebuffer) {
+  int num_samples = adaptive_ ? max_samples_ : num_samples_;
+  const std::vector<Tile>& tiles = framebuffer->Tiles();
+  std::atomic<int64_t> total_samples(0);
+  ParallelFor(0, static_cast<int>(tiles.size()), [&](int t) {
+    const Tile& tile = tiles[t];
+    int size = tile.Width() * tile.Height();
+    std::vector<Vec3f> sums(size, Vec3f(0, 0, 0));
+    std::vector<int> counts(size, 0);
+    std::vector<float> squares(size, 0);
+    TileBuffers buffers = {sums.data(), counts.data(), squares.data(),
+                           nullptr, tile.x0, tile.y0, tile.Width()};
+    RenderTile(scene, camera, tile, 0, num_samples, buffers);
+
+    Vec3f* data = framebuffer->TileData(t);
+    int64_t tile_samples = 0;
+    for (int p = 0; p < size; ++p) {
+      data[p] = counts[p] > 0 ? sums[p] / static_cast<float>(counts[p]) :
+                                Vec3f(0, 0, 0);
+      tile_samples += counts[p];
+    }
+    framebuffer->Evict(t);
+    total_samples += tile_samples;
+  });
+  int64_t num_pixels = static_cast<int64_t>(framebuffer->Width()) *
+                       framebuffer->Height();
+  return num_pixels > 0 ? static_cast<float>(total_samples) / num_pixels : 0;
+}
+
+void Pathtracer::RenderTile(const Scene& scene, const Camera& camera,
+                            const Tile& tile, int first_sample,
+                            int num_samples, const TileBuffers& buffers) {
+  int width = width_;
+  int height = height_;
+  int min_samples = adaptive_ && !progressive_ ? min_samples_ : num_samples;
+  std::unique_ptr<Sampler> sampler = NewSampler(num_samples);
+  for (int j = tile.y0; j < tile.y1; ++j) {
+    // Primary rays of adjacent pixels are traced together as a packet,
+    // the bounces continue one ray at a time.
+    for (int i = tile.x0; i < tile.x1; i += packet_size_) {
+      int size = std::min(packet_size_, tile.x1 - i);
+      PixelStats stats[RayPacket::kMaxSize];
+      // Pixels which still need samples.
+      int active[RayPacket::kMaxSize];
+      int num_active = size;
+      for (int p = 0; p < size; ++p) {
+        active[p] = p;
+      }
+
+      for (int k = 0; k < num_samples && num_active > 0; ++k) {
+        int sample = first_sample + k;
+        if (packet_size_ == 1) {
+          sampler->Start(i, j, sample);
+          Ray ray = camera.GetRay(i, j, width, height, sampler.get());
+          TraceResult result;
+          int obj = scene.Trace(ray, 0.001, FLT_MAX, &result);
+          if (buffers.guides) {
+            buffers.guides->Add(i + j * width, scene, obj, result);
+          }
+          stats[0].Add(Shade(scene, ray, obj, result, sampler.get(), 0));
+        } else {
+          // Every pixel has its own sample values, remember where each one
+          // left off while the packet is traced.
+          uint32_t dimensions[RayPacket::kMaxSize];
+          RayPacket packet;
+          for (int a = 0; a < num_active; ++a) {
+            sampler->Start(i + active[a], j, sample);
+            packet.Add(camera.GetRay(i + active[a], j, width, height,
+                                     sampler.get()));
+            dimensions[a] = sampler->Dimension();
+          }
+          int objs[RayPacket::kMaxSize];
+          TraceResult results[RayPacket::kMaxSize];
+          scene.TracePacket(packet, 0.001, FLT_MAX, objs, results);
+          for (int a = 0; a < num_active; ++a) {
+            if (buffers.guides) {
+              buffers.guides->Add(i + active[a] + j * width, scene, objs[a],
+                                  results[a]);
+            }
+            sampler->Start(i + active[a], j, sample, dimensions[a]);
+            stats[active[a]].Add(Shade(scene, packet.Get(a), objs[a],
+                                       results[a], sampler.get(), 0));
+          }
+        }
+
+        if (k + 1 >= min_samples && k + 1 < num_samples) {
+          int remaining = 0;
+          for (int a = 0; a < num_active; ++a) {
+            if (stats[active[a]].RelativeError() > threshold_) {
+              active[remaining++] = active[a];
+            }
+          }
+          num_active = remaining;
+        }
+      }
+
+      int index = (i - buffers.x0) + (j - buffers.y0) * buffers.stride;
+      for (int p = 0; p < size; ++p) {
+        buffers.sums[index + p] = buffers.sums[index + p] + stats[p].Sum();
+        buffers.counts[index + p] += stats[p].Count();
+        buffers.squares[index + p] += stats[p].Squares();
       }
-      color = color / static_cast<float>(num_samples_);
-      image_(i, j) = Vec3fToRGBA(GammaCorrect(color, 2.0f));
     }
+  }
+}
+
+void Pathtracer::RenderWavefront(const Scene& scene, const Camera& camera,
+                                 const Tile& region, int first_sample,
+                                 int num_samples) {
+  int width = image_.Width();
+  int height = image_.Height();
+  int num_pixels = region.Width() * region.Height();
+  int batch = std::max(kWavefrontSize / std::max(num_samples, 1), 1);
+  int num_batches = (num_pixels + batch - 1) / batch;
+
+  ParallelFor(0, num_batches, [&](int b) {
+    int first = b * batch;
+    int count = std::min(batch, num_pixels - first);
+    std::unique_ptr<Sampler> sampler = NewSampler(num_samples);
+    Wavefront wavefront(scene, camera, sampler.get(), max_depth_,
+                        roulette_depth_, roulette_threshold_);
+    wavefront.Render(width, height, region, first, count, first_sample,
+                     num_samples, accumulation_.Data(),
+                     luminance_squares_.Data(), &guides_);
   });
-  return image_;
+
+  for (int j = region.y0; j < region.y1; ++j) {
+    for (int i = region.x0; i < region.x1; ++i) {
+      sample_counts_(i, j) += num_samples;
+    }
+  }
+}
+
+void Pathtracer::Resolve(const Tile& region) {
+  for (int j = region.y0; j < region.y1; ++j) {
+    for (int i = region.x0; i < region.x1; ++i) {
+      int count = sample_counts_(i, j);
+      image_(i, j) = count ? accumulation_(i, j) / static_cast<float>(count)
+                           : Vec3f(0, 0, 0);
+    }
+  }
+  if (!denoiser_.Enabled()) {
+    denoised_valid_ = false;
+    return;
+  }
+  // Only the region is filtered again, the rest of denoised_ has to come
+  // from an earlier denoise of the same image.
+  Tile denoise_region = region;
+  if (!denoised_valid_) {
+    denoise_region = Tile(0, 0, image_.Width(), image_.Height());
+  }
+  denoiser_.Apply(image_, guides_, sample_counts_, denoise_region,
+                  &denoised_);
+  denoised_valid_ = true;
+}
+
+const Image<Vec3f>& Pathtracer::Output() const {
+  return denoiser_.Enabled() ? denoised_ : image_;
 }
@@ -3,28 +3,217 @@
 #ifndef RAYTRACER_H_
 #define RAYTRACER_H_
 
+#include <stdint.h>
+#include <functional>
+#include <string>
+
 #include "./camera.h"
+#include "./denoiser.h"
+#include "./framebuffer.h"
 #include "./image.h"
 #include "./ray.h"
+#include "./roulette.h"
+#include "./sampler.h"
 #include "./scene.h"
+#include "./tile.h"
 #include "./vec3.h"
 
+enum Integrator {
+  // Follows one path at a time, see Pathtracer::Trace.
+  kIntegratorRecursive,
+  // Advances batches of paths together, see Wavefront.
+  kIntegratorWavefront,
+};
+
+// Arbitrary output variables, per pixel data gathered in the same pass as
+// the radiance.
+enum Aov {
+  // Mean first hit normal.
+  kAovNormal,
+  // Mean distance from the camera to the first hit.
+  kAovDepth,
+  // Mean albedo of the first hit material.
+  kAovAlbedo,
+  // Scene id of the first object hit through the pixel.
+  kAovObjectId,
+  kAovSampleCount,
+  // Variance of the luminance of the samples.
+  kAovVariance,
+};
+
 class Pathtracer {
  public:
   Pathtracer(int width, int height, int num_samples, int max_depth);
 
+  // Buffers are allocated by the next Render, so a pathtracer which only
+  // renders into a TiledFramebuffer never holds a full frame in memory.
   void SetSize(int width, int height);
+  int Width() const { return width_; }
+  int Height() const { return height_; }
+  // Restricts renders to the pixels in [x0, x1) x [y0, y1), clipped to the
+  // image. The rest of the image keeps what earlier renders left in it, and
+  // a render costs time in proportion to the area of the region. The
+  // samples of the region start over unless a progressive render continues
+  // with the same region. An empty region renders the whole image.
+  void SetRegion(int x0, int y0, int x1, int y1);
   void SetSamples(int num_samples);
   void SetMaxDepth(int max_depth);
+  // Paths which scattered at least min_depth times play Russian roulette
+  // after every further bounce once their throughput drops below
+  // threshold, see SurvivesRoulette. A min_depth of max_depth or more
+  // disables it.
+  void SetRoulette(int min_depth, float threshold);
+  // Number of adjacent primary rays traced together, 1 disables packets.
+  void SetPacketSize(int packet_size);
+  void SetIntegrator(Integrator integrator);
+  void SetSampler(SamplerType sampler);
+  // Renders only depend on the seed, not on the number of threads.
+  void SetSeed(uint32_t seed);
+  // Keeps sampling each pixel after min_samples until the relative standard
+  // error of its mean drops below threshold or max_samples is reached.
+  // A threshold of zero disables adaptive sampling. Only used by the
+  // recursive integrator outside of progressive mode.
+  void SetAdaptive(int min_samples, int max_samples, float threshold);
+  bool Adaptive() const { return adaptive_; }
+  // Renders in passes of pass_samples samples per pixel until max_samples
+  // are accumulated or time_budget seconds have been spent. The next render
+  // of an unchanged scene and camera continues adding samples to the same
+  // image. A max_samples or time_budget of zero removes that limit, if both
+  // are zero the image stops at the number of samples set by SetSamples.
+  // A pass_samples of zero disables progressive mode.
+  void SetProgressive(int pass_samples, int max_samples, double time_budget);
+  bool Progressive() const { return progressive_; }
+  // Saves the accumulated samples to filename every interval seconds during
+  // a progressive render and when a render finishes. An empty filename
+  // disables checkpoints.
+  void SetCheckpoint(const std::string& filename, double interval);
+  // Filters the image with iterations passes of the à-trous denoiser after
+  // every render, see Denoiser::SetSigmas. Zero iterations disable it. The
+  // accumulated samples are left untouched, so a progressive render can be
+  // denoised again with other settings without tracing more samples.
+  void SetDenoise(int iterations, float sigma_color, float sigma_normal,
+                  float sigma_depth, float sigma_albedo);
+
+  // Writes the accumulation buffer, the sample counts, the index of the next
+  // sample and the state hash to a binary file.
+  bool SaveCheckpoint(const char* filename) const;
+  // Restores a checkpoint. The next progressive render continues from it if
+  // the scene, camera and settings hash the same as when it was written.
+  bool LoadCheckpoint(const char* filename);
 
-  Vec3f Trace(const Scene& scene, const Ray& ray, int depth) const;
+  // Average number of samples per pixel in the image.
+  float AverageSamples() const;
 
-  const Image<RGBA>& Render(const Scene& scene, const Camera& camera);
+  // Fills image with an AOV of the last render, with the scalar ones
+  // repeated in all three channels. Pixels without a hit are zero, except
+  // for object ids which are -1. With display set the values are mapped to
+  // [0, 1] for 8 bit images: normals to n * 0.5 + 0.5, depth and sample
+  // counts divided by their maximum, variance v to v / (1 + v) and object
+  // ids to random colors.
+  void GetAov(Aov aov, bool display, Image<Vec3f>* image) const;
+
+  Vec3f Trace(const Scene& scene, const Ray& ray, Sampler* sampler,
+              int depth) const;
+
+  // Returns the radiance along a ray given its closest hit in the scene.
+  // The path is followed bounce by bounce in a loop which carries its
+  // throughput forward.
+  Vec3f Shade(const Scene& scene, const Ray& ray, int obj,
+              const TraceResult& result, Sampler* sampler, int depth) const;
+
+  // Called after every pass with the number of passes so far and the
+  // current image.
+  typedef std::function<void(int, const Image<Vec3f>&)> PassCallback;
+
+  // Returns the linear radiance of each pixel, denoised if enabled. Use
+  // PostProcess for an 8 bit image.
+  const Image<Vec3f>& Render(const Scene& scene, const Camera& camera,
+                             const PassCallback& on_pass = nullptr);
+  // The image returned by the last render.
+  const Image<Vec3f>& Output() const;
+  // Renders the mean radiance of each pixel straight into framebuffer, one
+  // tile at a time in the order of its storage, and evicts every tile once
+  // it is finished. Only the samples of the tiles in flight are kept in
+  // memory, so progressive mode, denoising and AOVs are not available and
+  // the wavefront integrator falls back to tiles. Returns the average
+  // number of samples per pixel. The region is ignored.
+  float RenderTiled(const Scene& scene, const Camera& camera,
+                    TiledFramebuffer* framebuffer);
 
  private:
+  // Per pixel sums written by RenderTile, for the pixels of a region which
+  // starts at (x0, y0). Pixel (x, y) is at (x - x0) + (y - y0) * stride.
+  struct TileBuffers {
+    Vec3f* sums;
+    int* counts;
+    float* squares;
+    // Indexed by x + y * width of the whole image, null to skip them.
+    GuideBuffers* guides;
+    int x0;
+    int y0;
+    int stride;
+  };
+
+  // Resizes the buffers to the size given by SetSize.
+  void Allocate();
+  // The pixels a render covers, see SetRegion.
+  Tile Region() const;
+  // Hash of everything the accumulated samples depend on.
+  uint64_t StateHash(const Scene& scene, const Camera& camera) const;
+  // Each worker draws its samples from its own sampler.
+  std::unique_ptr<Sampler> NewSampler(int num_samples) const;
+  // Adds samples [first_sample, first_sample + num_samples) of every pixel
+  // to the accumulation buffer.
+  void RenderPass(const Scene& scene, const Camera& camera,
+                  const Tile& region, int first_sample, int num_samples);
+  void RenderTile(const Scene& scene, const Camera& camera, const Tile& tile,
+                  int first_sample, int num_samples,
+                  const TileBuffers& buffers);
+  void RenderWavefront(const Scene& scene, const Camera& camera,
+                       const Tile& region, int first_sample, int num_samples);
+  // Computes the mean radiance of the pixels in region from the
+  // accumulation buffer and denoises them.
+  void Resolve(const Tile& region);
+
   int num_samples_;
   int max_depth_;
-  Image<RGBA> image_;
+  int roulette_depth_;
+  float roulette_threshold_;
+  int packet_size_;
+  Integrator integrator_;
+  SamplerType sampler_;
+  uint32_t seed_;
+  bool adaptive_;
+  int min_samples_;
+  int max_samples_;
+  float threshold_;
+  bool progressive_;
+  int pass_samples_;
+  int progressive_samples_;
+  double time_budget_;
+  std::string checkpoint_file_;
+  double checkpoint_interval_;
+  // Sum of the samples of each pixel and their number.
+  Image<Vec3f> accumulation_;
+  Image<int> sample_counts_;
+  // Sum of the squared luminance of the samples of each pixel.
+  Image<float> luminance_squares_;
+  // Sums of the first hit features, which guide the denoiser.
+  GuideBuffers guides_;
+  // Index of the next sample of each pixel and the state hash of the
+  // accumulated samples.
+  int next_sample_;
+  uint64_t state_hash_;
+  int num_passes_;
+  int width_;
+  int height_;
+  Tile region_;
+  Image<Vec3f> image_;
+  Denoiser denoiser_;
+  Image<Vec3f> denoised_;
+  // Whether all of denoised_ is the filtered image_, which is needed before
+  // only a region of it can be filtered again.
+  bool denoised_valid_;
 };
 
 #endif  // RAYTRACER_H_
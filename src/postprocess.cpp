@@ -0,0 +1,197 @@
+// Copyright 2018, Vahid Kazemi
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#include "./concurrency.h"
+#include "./postprocess.h"
+#include "./sampler.h"
+#include "./simd.h"
+
+namespace {
+
+// Offsets of the dither noise of the green and blue channels in the blue
+// noise mask, so that the channels don't share their noise.
+const int kDitherOffsetX = 23;
+const int kDitherOffsetY = 41;
+
+// Pixels converted at a time by each worker, a multiple of simd::kWidth.
+const int kChunkPixels = 256;
+
+// Approximates the sRGB curve above its linear segment with square roots,
+// within a quarter of an 8 bit step.
+inline simd::Float EncodeSrgb(simd::Float x) {
+  simd::Float s1 = simd::Sqrt(x);
+  simd::Float s2 = simd::Sqrt(s1);
+  simd::Float s3 = simd::Sqrt(s2);
+  simd::Float curve = simd::Sub(
+    simd::Add(simd::Mul(simd::Set(0.662002687f), s1),
+              simd::Mul(simd::Set(0.684122060f), s2)),
+    simd::Add(simd::Mul(simd::Set(0.323583601f), s3),
+              simd::Mul(simd::Set(0.0225411470f), x)));
+  simd::Float linear = simd::Mul(x, simd::Set(12.92f));
+  return simd::Select(simd::Greater(x, simd::Set(0.0031308f)), curve,
+                      linear);
+}
+
+}  // namespace
+
+PostProcess::PostProcess()
+  : exposure_(0), tonemap_(kTonemapClamp), gamma_(2.0f), dither_(false) {}
+
+void PostProcess::SetExposure(float stops) {
+  exposure_ = stops;
+}
+
+void PostProcess::SetTonemap(Tonemap tonemap) {
+  tonemap_ = tonemap;
+}
+
+void PostProcess::SetGamma(float gamma) {
+  gamma_ = std::max(gamma, 0.0f);
+}
+
+void PostProcess::SetDither(bool dither) {
+  dither_ = dither;
+}
+
+void PostProcess::Apply(const Image<Vec3f>& radiance,
+                        Image<RGBA>* result) const {
+  int width = radiance.Width();
+  int height = radiance.Height();
+  result->SetSize(width, height);
+  const std::vector<float>& mask = BlueNoiseMask();
+  simd::Float scale = simd::Set(exp2f(exposure_));
+  simd::Float zero = simd::Set(0.0f);
+  simd::Float one = simd::Set(1.0f);
+
+  ParallelFor(0, height, [&](int y) {
+    const float* noise[3];
+    for (int c = 0; c < 3; ++c) {
+      int row = (y + c * kDitherOffsetY) & (kBlueNoiseSize - 1);
+      noise[c] = &mask[row * kBlueNoiseSize];
+    }
+    // Every channel is processed on its own, so the pixels are handled as
+    // a flat array of floats, a chunk at a time.
+    float values[3 * kChunkPixels];
+    float offsets[3 * kChunkPixels];
+    for (int x0 = 0; x0 < width; x0 += kChunkPixels) {
+      int count = std::min(kChunkPixels, width - x0);
+      int size = 3 * count;
+      int padded = (size + simd::kWidth - 1) / simd::kWidth * simd::kWidth;
+      memcpy(values, &radiance(x0, y), size * sizeof(float));
+      std::fill(values + size, values + padded, 0.0f);
+      if (dither_) {
+        for (int x = 0; x < count; ++x) {
+          for (int c = 0; c < 3; ++c) {
+            offsets[3 * x + c] = noise[c][(x0 + x + c * kDitherOffsetX) &
+                                          (kBlueNoiseSize - 1)];
+          }
+        }
+        std::fill(offsets + size, offsets + padded, 0.0f);
+      }
+
+      for (int i = 0; i < padded; i += simd::kWidth) {
+        // NaNs turn into zero, Max returns its second argument for them.
+        simd::Float v = simd::Max(simd::Mul(simd::Load(values + i), scale),
+                                  zero);
+        switch (tonemap_) {
+          case kTonemapClamp:
+            break;
+          case kTonemapReinhard:
+            v = simd::Div(v, simd::Add(v, one));
+            break;
+          case kTonemapAces: {
+            v = simd::Mul(v, simd::Set(0.6f));
+            simd::Float a = simd::Mul(v, simd::Add(
+              simd::Mul(v, simd::Set(2.51f)), simd::Set(0.03f)));
+            simd::Float b = simd::Add(simd::Mul(v, simd::Add(
+              simd::Mul(v, simd::Set(2.43f)), simd::Set(0.59f))),
+              simd::Set(0.14f));
+            v = simd::Div(a, b);
+            break;
+          }
+        }
+        v = simd::Min(v, one);
+
+        if (gamma_ == 0) {
+          v = EncodeSrgb(v);
+        } else if (gamma_ == 2) {
+          v = simd::Sqrt(v);
+        } else if (gamma_ != 1) {
+          float lanes[simd::kWidth];
+          simd::Store(lanes, v);
+          for (int l = 0; l < simd::kWidth; ++l) {
+            lanes[l] = powf(lanes[l], 1 / gamma_);
+          }
+          v = simd::Load(lanes);
+        }
+
+        // Rounds, or adds the dither noise before truncating.
+        simd::Float offset = dither_ ? simd::Load(offsets + i)
+                                     : simd::Set(0.5f);
+        v = simd::Add(simd::Mul(v, simd::Set(255.0f)), offset);
+        simd::Store(values + i, simd::Min(v, simd::Set(255.0f)));
+      }
+
+      RGBA* out = &(*result)(x0, y);
+      for (int x = 0; x < count; ++x) {
+        out[x] = RGBA(static_cast<uint8_t>(values[3 * x]),
+                      static_cast<uint8_t>(values[3 * x + 1]),
+                      static_cast<uint8_t>(values[3 * x + 2]), 255);
+      }
+    }
+  });
+}
+
+bool SaveImage(const char* filename, const Image<Vec3f>& radiance,
+               const PostProcess& post) {
+  if (IsHdrFilename(filename)) {
+    return WriteHdrImage(filename, radiance);
+  }
+  Image<RGBA> image;
+  post.Apply(radiance, &image);
+  return WriteImage(filename, image);
+}
+
+bool SaveImageRows(const char* filename, int width, int height,
+                   const RowSource& rows, const PostProcess& post) {
+  if (IsHdrFilename(filename)) {
+    return WriteHdrRows(filename, width, height, rows);
+  }
+  if (!IsPpmFilename(filename)) {
+    fprintf(stderr, "Unsupported format for streamed images: %s\n",
+            filename);
+    return false;
+  }
+  FILE* file = fopen(filename, "wb");
+  if (!file) {
+    return false;
+  }
+  fprintf(file, "P6\n%d %d\n255\n", width, height);
+  // Strips as high as the blue noise mask keep the dither pattern the same
+  // as when the whole image is processed at once.
+  Image<Vec3f> strip(width, kBlueNoiseSize);
+  Image<RGBA> pixels;
+  std::vector<uint8_t> line(3 * width);
+  for (int y0 = 0; y0 < height; y0 += kBlueNoiseSize) {
+    int count = std::min(kBlueNoiseSize, height - y0);
+    strip.SetSize(width, count);
+    for (int j = 0; j < count; ++j) {
+      rows(y0 + j, &strip(0, j));
+    }
+    post.Apply(strip, &pixels);
+    for (int j = 0; j < count; ++j) {
+      for (int i = 0; i < width; ++i) {
+        line[3 * i] = pixels(i, j).r;
+        line[3 * i + 1] = pixels(i, j).g;
+        line[3 * i + 2] = pixels(i, j).b;
+      }
+      fwrite(line.data(), 1, line.size(), file);
+    }
+  }
+  return fclose(file) == 0;
+}
@@ -0,0 +1,55 @@
+// Copyright 2018, Vahid Kazemi
+
+#ifndef POSTPROCESS_H_
+#define POSTPROCESS_H_
+
+#include "./color.h"
+#include "./image.h"
+#include "./vec3.h"
+
+enum Tonemap {
+  // Clips everything above 1.
+  kTonemapClamp,
+  // x / (1 + x) per channel.
+  kTonemapReinhard,
+  // Narkowicz's fit of the ACES filmic curve.
+  kTonemapAces,
+};
+
+// Turns linear radiance into 8 bit pixels: exposure, tonemapping, transfer
+// function and quantization. Rows are processed in parallel, simd::kWidth
+// channels at a time. The defaults match ConvertToRGBA with a gamma of 2.
+class PostProcess {
+ public:
+  PostProcess();
+
+  // Scales the radiance by 2^stops.
+  void SetExposure(float stops);
+  void SetTonemap(Tonemap tonemap);
+  // Encodes with x^(1 / gamma), or with the sRGB curve if gamma is zero.
+  // Gammas of 0, 1 and 2 use fast paths, others call powf.
+  void SetGamma(float gamma);
+  // Adds blue noise of up to one step before quantizing, which turns the
+  // banding of smooth gradients into fine grain.
+  void SetDither(bool dither);
+
+  void Apply(const Image<Vec3f>& radiance, Image<RGBA>* result) const;
+
+ private:
+  float exposure_;
+  Tonemap tonemap_;
+  float gamma_;
+  bool dither_;
+};
+
+// HDR formats receive the linear radiance, anything else goes through post
+// first.
+bool SaveImage(const char* filename, const Image<Vec3f>& radiance,
+               const PostProcess& post);
+
+// Streams an image row by row, see WriteHdrRows. 8 bit images go through
+// post and are written as binary PPM.
+bool SaveImageRows(const char* filename, int width, int height,
+                   const RowSource& rows, const PostProcess& post);
+
+#endif  // POSTPROCESS_H_
@@ -3,67 +3,51 @@
 #ifndef RAND_H_
 #define RAND_H_
 
-#include <random>
-
-#include "./vec3.h"
-
-template<class T>
-class RandomPointInUnitDisk {
- public:
-  RandomPointInUnitDisk() : uniform_dist_(-1, 1) {}
-
-  template<class URNG>
-  Vec3<T> operator()(URNG& g) {
-    Vec3<T> u;
-    do {
-      u = Vec3<T>(uniform_dist_(g), uniform_dist_(g), 0.0f);
-    } while (SquaredLength(u) >= 1.0);
-    return u;
-  }
-
- private:
-  std::uniform_real_distribution<T> uniform_dist_;
-};
-
-template<class T>
-class RandomPointInUnitSphere {
- public:
-  RandomPointInUnitSphere() : uniform_dist_(-1, 1) {}
-
-  template<class URNG>
-  Vec3<T> operator()(URNG& g) {
-    Vec3<T> u;
-    do {
-      u = Vec3<T>(uniform_dist_(g), uniform_dist_(g), uniform_dist_(g));
-    } while (SquaredLength(u) >= 1.0);
-    return u;
-  }
-
- private:
-  std::uniform_real_distribution<T> uniform_dist_;
-};
-
-class Random {
- public:
-  static std::mt19937& Generator() {
-    thread_local static std::mt19937 generator;
-    return generator;
-  }
-
-  static float Uniform() {
-    thread_local static std::uniform_real_distribution<float> uniform_dist(0, 1);
-    return uniform_dist(Generator());
-  }
-
-  static Vec3f PointInUnitDisk() {
-    thread_local static RandomPointInUnitDisk<float> disk_dist;
-    return disk_dist(Generator());
-  }
-
-  static Vec3f PointInUnitSphere() {
-    thread_local static RandomPointInUnitSphere<float> sphere_dist;
-    return sphere_dist(Generator());
+#include <stdint.h>
+
+// Philox4x32-10 counter based generator. Maps a 128 bit counter and a 64 bit
+// key to 128 random bits without any state, so every random number can be
+// addressed directly and computed independently of the others.
+inline void Philox4x32(const uint32_t counter[4], const uint32_t key[2],
+                       uint32_t out[4]) {
+  uint32_t c0 = counter[0], c1 = counter[1];
+  uint32_t c2 = counter[2], c3 = counter[3];
+  uint32_t k0 = key[0], k1 = key[1];
+  for (int round = 0; round < 10; ++round) {
+    uint64_t p0 = uint64_t(0xD2511F53u) * c0;
+    uint64_t p1 = uint64_t(0xCD9E8D57u) * c2;
+    uint32_t n0 = uint32_t(p1 >> 32) ^ c1 ^ k0;
+    uint32_t n2 = uint32_t(p0 >> 32) ^ c3 ^ k1;
+    c1 = uint32_t(p1);
+    c3 = uint32_t(p0);
+    c0 = n0;
+    c2 = n2;
+    k0 += 0x9E3779B9u;
+    k1 += 0xBB67AE85u;
   }
-};
+  out[0] = c0;
+  out[1] = c1;
+  out[2] = c2;
+  out[3] = c3;
+}
+
+// Maps 32 random bits to a float in [0, 1).
+inline float UintToFloat(uint32_t x) {
+  return (x >> 8) * (1.0f / 16777216.0f);
+}
+
+// Mixes the bits of a 32 bit integer.
+inline uint32_t Hash(uint32_t x) {
+  x ^= x >> 16;
+  x *= 0x7FEB352Du;
+  x ^= x >> 15;
+  x *= 0x846CA68Bu;
+  x ^= x >> 16;
+  return x;
+}
+
+inline uint32_t HashCombine(uint32_t seed, uint32_t v) {
+  return seed ^ (Hash(v) + 0x9E3779B9u + (seed << 6) + (seed >> 2));
+}
 
 #endif  // RAND_H_
@@ -18,4 +18,35 @@ inline Vec3f PointAt(const Ray& ray, float t) {
   return ray.direction * t + ray.origin;
 }
 
+// A small group of coherent rays in structure of arrays layout, traced
+// together through the scene.
+struct RayPacket {
+  static const int kMaxSize = 16;
+
+  RayPacket() : size(0) {}
+
+  void Add(const Ray& ray) {
+    origin_x[size] = ray.origin.x;
+    origin_y[size] = ray.origin.y;
+    origin_z[size] = ray.origin.z;
+    direction_x[size] = ray.direction.x;
+    direction_y[size] = ray.direction.y;
+    direction_z[size] = ray.direction.z;
+    size++;
+  }
+
+  Ray Get(int i) const {
+    return Ray(Vec3f(origin_x[i], origin_y[i], origin_z[i]),
+               Vec3f(direction_x[i], direction_y[i], direction_z[i]));
+  }
+
+  int size;
+  alignas(32) float origin_x[kMaxSize];
+  alignas(32) float origin_y[kMaxSize];
+  alignas(32) float origin_z[kMaxSize];
+  alignas(32) float direction_x[kMaxSize];
+  alignas(32) float direction_y[kMaxSize];
+  alignas(32) float direction_z[kMaxSize];
+};
+
 #endif  // RAY_H_
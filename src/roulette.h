@@ -0,0 +1,36 @@
+// Copyright 2018, Vahid Kazemi
+
+#ifndef ROULETTE_H_
+#define ROULETTE_H_
+
+#include <algorithm>
+
+#include "./sampler.h"
+#include "./vec3.h"
+
+// Defaults of Pathtracer::SetRoulette.
+const int kRouletteMinDepth = 3;
+const float kRouletteThreshold = 0.25f;
+
+// Russian roulette: a path whose throughput is below threshold in every
+// channel continues with probability max channel / threshold, and is
+// weighted up by the inverse when it does, which keeps the estimate
+// unbiased. Survivors come out with their largest channel at threshold, so
+// a low threshold only ends paths which contribute little and adds little
+// noise. Draws one value from the sampler only if the roulette is played.
+// Returns false if the path ends.
+inline bool SurvivesRoulette(float threshold, Vec3f* throughput,
+                             Sampler* sampler) {
+  float p = std::max(throughput->x, std::max(throughput->y, throughput->z)) /
+            threshold;
+  if (p >= 1) {
+    return true;
+  }
+  if (sampler->Get1D() >= p) {
+    return false;
+  }
+  *throughput = *throughput / p;
+  return true;
+}
+
+#endif  // ROULETTE_H_
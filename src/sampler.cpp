@@ -0,0 +1,332 @@
+// Copyright 2018, Vahid Kazemi
+
+#include <math.h>
+#include <algorithm>
+#include <vector>
+
+#include "./rand.h"
+#include "./sampler.h"
+
+namespace {
+
+uint32_t ReverseBits(uint32_t x) {
+  x = (x << 16) | (x >> 16);
+  x = ((x & 0x00FF00FFu) << 8) | ((x & 0xFF00FF00u) >> 8);
+  x = ((x & 0x0F0F0F0Fu) << 4) | ((x & 0xF0F0F0F0u) >> 4);
+  x = ((x & 0x33333333u) << 2) | ((x & 0xCCCCCCCCu) >> 2);
+  x = ((x & 0x55555555u) << 1) | ((x & 0xAAAAAAAAu) >> 1);
+  return x;
+}
+
+// Owen scrambling of a value in bit reversed order, after Burley,
+// "Practical Hash-based Owen Scrambling". Applied to an index it shuffles
+// the points of the sequence, applied to a point it scrambles its digits.
+uint32_t NestedUniformScramble(uint32_t x, uint32_t seed) {
+  x = ReverseBits(x);
+  x += seed;
+  x ^= x * 0x6C50B47Cu;
+  x ^= x * 0xB82F1E52u;
+  x ^= x * 0xC7AFE638u;
+  x ^= x * 0x8D22F6E6u;
+  return ReverseBits(x);
+}
+
+// First two dimensions of the Sobol sequence, which form a (0, 2)-sequence.
+uint32_t Sobol0(uint32_t index) {
+  return ReverseBits(index);
+}
+
+uint32_t Sobol1(uint32_t index) {
+  uint32_t result = 0;
+  for (uint32_t v = 1u << 31; index; index >>= 1, v ^= v >> 1) {
+    if (index & 1) {
+      result ^= v;
+    }
+  }
+  return result;
+}
+
+// Random permutation of [0, size) indexed by i, after Kensler,
+// "Correlated Multi-Jittered Sampling".
+uint32_t Permute(uint32_t i, uint32_t size, uint32_t p) {
+  uint32_t w = size - 1;
+  w |= w >> 1;
+  w |= w >> 2;
+  w |= w >> 4;
+  w |= w >> 8;
+  w |= w >> 16;
+  do {
+    i ^= p;
+    i *= 0xE170893Du;
+    i ^= p >> 16;
+    i ^= (i & w) >> 4;
+    i ^= p >> 8;
+    i *= 0x0929EB3Fu;
+    i ^= p >> 23;
+    i ^= (i & w) >> 1;
+    i *= 1 | p >> 27;
+    i *= 0x6935FA69u;
+    i ^= (i & w) >> 11;
+    i *= 0x74DCB303u;
+    i ^= (i & w) >> 2;
+    i *= 0x9E501CC3u;
+    i ^= (i & w) >> 2;
+    i *= 0xC860A3DFu;
+    i &= w;
+    i ^= i >> 5;
+  } while (i >= size);
+  return (i + p) % size;
+}
+
+const int kMaskSize = kBlueNoiseSize;
+
+// Builds a kMaskSize x kMaskSize blue noise mask with Ulichney's void and
+// cluster method. Every value in [0, 1) is taken by one texel and nearby
+// texels have dissimilar values.
+std::vector<float> GenerateBlueNoise() {
+  const int n = kMaskSize * kMaskSize;
+  const float sigma = 1.5f;
+
+  // Gaussian energy of a point at the origin on the torus.
+  std::vector<float> kernel(n);
+  for (int y = 0; y < kMaskSize; ++y) {
+    for (int x = 0; x < kMaskSize; ++x) {
+      int dx = std::min(x, kMaskSize - x);
+      int dy = std::min(y, kMaskSize - y);
+      kernel[y * kMaskSize + x] =
+        expf(-(dx * dx + dy * dy) / (2 * sigma * sigma));
+    }
+  }
+
+  std::vector<bool> pattern(n, false);
+  std::vector<float> energy(n, 0.0f);
+  auto toggle = [&](int p) {
+    pattern[p] = !pattern[p];
+    float sign = pattern[p] ? 1.0f : -1.0f;
+    int px = p % kMaskSize;
+    int py = p / kMaskSize;
+    for (int y = 0; y < kMaskSize; ++y) {
+      const float* row = &kernel[((y - py) & (kMaskSize - 1)) * kMaskSize];
+      for (int x = 0; x < kMaskSize; ++x) {
+        energy[y * kMaskSize + x] += sign * row[(x - px) & (kMaskSize - 1)];
+      }
+    }
+  };
+  // The set point with the most energy around it.
+  auto tightest_cluster = [&]() {
+    int best = -1;
+    for (int p = 0; p < n; ++p) {
+      if (pattern[p] && (best < 0 || energy[p] > energy[best])) {
+        best = p;
+      }
+    }
+    return best;
+  };
+  // The empty point with the least energy around it.
+  auto largest_void = [&]() {
+    int best = -1;
+    for (int p = 0; p < n; ++p) {
+      if (!pattern[p] && (best < 0 || energy[p] < energy[best])) {
+        best = p;
+      }
+    }
+    return best;
+  };
+
+  // Initial pattern of random points, spread out by repeatedly moving the
+  // most clustered point into the largest void.
+  int num_initial = n / 10;
+  for (int k = 0, count = 0; count < num_initial; ++k) {
+    int p = Hash(k) % n;
+    if (!pattern[p]) {
+      toggle(p);
+      count++;
+    }
+  }
+  for (int iteration = 0; iteration < n; ++iteration) {
+    int cluster = tightest_cluster();
+    toggle(cluster);
+    int hole = largest_void();
+    toggle(hole);
+    if (hole == cluster) {
+      break;
+    }
+  }
+
+  std::vector<int> rank(n);
+  std::vector<bool> initial_pattern = pattern;
+  std::vector<float> initial_energy = energy;
+  for (int r = num_initial - 1; r >= 0; --r) {
+    int cluster = tightest_cluster();
+    toggle(cluster);
+    rank[cluster] = r;
+  }
+  pattern = initial_pattern;
+  energy = initial_energy;
+  for (int r = num_initial; r < n; ++r) {
+    int hole = largest_void();
+    toggle(hole);
+    rank[hole] = r;
+  }
+
+  std::vector<float> mask(n);
+  for (int p = 0; p < n; ++p) {
+    mask[p] = (rank[p] + 0.5f) / n;
+  }
+  return mask;
+}
+
+class IndependentSampler : public Sampler {
+ public:
+  using Sampler::Sampler;
+
+  float Get1D() override {
+    return Uniform(dimension_++);
+  }
+
+  Vec2f Get2D() override {
+    float u = Uniform(dimension_++);
+    float v = Uniform(dimension_++);
+    return Vec2f(u, v);
+  }
+};
+
+// Splits [0, 1) into num_samples strata, and [0, 1)^2 into a grid of at
+// least as many cells, and places each sample of a pixel in its own jittered
+// stratum. The strata are shuffled independently for every pixel and
+// dimension. Samples beyond num_samples start a new round of strata.
+class StratifiedSampler : public Sampler {
+ public:
+  StratifiedSampler(int num_samples, uint32_t seed)
+    : Sampler(std::max(num_samples, 1), seed) {
+    grid_x_ = std::max(static_cast<int>(sqrtf(num_samples_)), 1);
+    grid_y_ = (num_samples_ + grid_x_ - 1) / grid_x_;
+  }
+
+  float Get1D() override {
+    uint32_t stratum = Stratum(num_samples_);
+    float jitter = Uniform(dimension_++);
+    return (stratum + jitter) / num_samples_;
+  }
+
+  Vec2f Get2D() override {
+    uint32_t stratum = Stratum(grid_x_ * grid_y_);
+    float jitter_x = Uniform(dimension_++);
+    float jitter_y = Uniform(dimension_++);
+    return Vec2f((stratum % grid_x_ + jitter_x) / grid_x_,
+                 (stratum / grid_x_ + jitter_y) / grid_y_);
+  }
+
+ private:
+  uint32_t Stratum(int num_strata) const {
+    uint32_t round = sample_ / num_samples_;
+    uint32_t index = sample_ % num_samples_;
+    uint32_t seed = HashCombine(HashCombine(HashCombine(
+      HashCombine(seed_, x_), y_), dimension_), round);
+    return Permute(index, num_strata, seed);
+  }
+
+  int grid_x_;
+  int grid_y_;
+};
+
+// Each pair of dimensions uses the first two Sobol dimensions, shuffled and
+// Owen scrambled with their own seed (Burley's padding), so any number of
+// dimensions is well stratified in 1D and 2D projections.
+class SobolSampler : public Sampler {
+ public:
+  using Sampler::Sampler;
+
+  float Get1D() override {
+    uint32_t seed = HashCombine(PixelSeed(), dimension_++);
+    uint32_t index = NestedUniformScramble(sample_, seed);
+    return UintToFloat(NestedUniformScramble(Sobol0(index),
+                                             HashCombine(seed, 0)));
+  }
+
+  Vec2f Get2D() override {
+    uint32_t seed = HashCombine(PixelSeed(), dimension_);
+    dimension_ += 2;
+    uint32_t index = NestedUniformScramble(sample_, seed);
+    return Vec2f(
+      UintToFloat(NestedUniformScramble(Sobol0(index),
+                                        HashCombine(seed, 0))),
+      UintToFloat(NestedUniformScramble(Sobol1(index),
+                                        HashCombine(seed, 1))));
+  }
+
+ protected:
+  virtual uint32_t PixelSeed() const {
+    return HashCombine(HashCombine(Hash(seed_), x_), y_);
+  }
+};
+
+// All pixels share the same scrambled Sobol sequence, which is rotated
+// toroidally by a blue noise value (Georgiev and Fajardo, "Blue-noise
+// Dithered Sampling"). Every dimension reads the mask at its own offset.
+class BlueNoiseSampler : public SobolSampler {
+ public:
+  BlueNoiseSampler(int num_samples, uint32_t seed)
+    : SobolSampler(num_samples, seed), mask_(BlueNoiseMask()) {}
+
+  float Get1D() override {
+    uint32_t dimension = dimension_;
+    return Shift(SobolSampler::Get1D(), dimension);
+  }
+
+  Vec2f Get2D() override {
+    uint32_t dimension = dimension_;
+    Vec2f u = SobolSampler::Get2D();
+    return Vec2f(Shift(u.x, dimension), Shift(u.y, dimension + 1));
+  }
+
+ protected:
+  uint32_t PixelSeed() const override {
+    return Hash(seed_);
+  }
+
+ private:
+  float Shift(float u, uint32_t dimension) const {
+    uint32_t offset = HashCombine(Hash(seed_), dimension);
+    int x = (x_ + offset) & (kMaskSize - 1);
+    int y = (y_ + (offset >> 16)) & (kMaskSize - 1);
+    u += mask_[y * kMaskSize + x];
+    return u < 1 ? u : u - 1;
+  }
+
+  const std::vector<float>& mask_;
+};
+
+}  // namespace
+
+const std::vector<float>& BlueNoiseMask() {
+  static const std::vector<float> mask = GenerateBlueNoise();
+  return mask;
+}
+
+float Sampler::Uniform(uint32_t dimension) const {
+  uint32_t counter[4] = {
+    static_cast<uint32_t>(x_), static_cast<uint32_t>(y_),
+    static_cast<uint32_t>(sample_), dimension / 4 };
+  uint32_t key[2] = { seed_, 0 };
+  uint32_t values[4];
+  Philox4x32(counter, key, values);
+  return UintToFloat(values[dimension % 4]);
+}
+
+std::unique_ptr<Sampler> CreateSampler(SamplerType type, int num_samples,
+                                       uint32_t seed) {
+  switch (type) {
+    case kSamplerStratified:
+      return std::unique_ptr<Sampler>(
+        new StratifiedSampler(num_samples, seed));
+    case kSamplerSobol:
+      return std::unique_ptr<Sampler>(new SobolSampler(num_samples, seed));
+    case kSamplerBlueNoise:
+      return std::unique_ptr<Sampler>(
+        new BlueNoiseSampler(num_samples, seed));
+    default:
+      return std::unique_ptr<Sampler>(
+        new IndependentSampler(num_samples, seed));
+  }
+}
@@ -0,0 +1,74 @@
+// Copyright 2018, Vahid Kazemi
+
+#ifndef SAMPLER_H_
+#define SAMPLER_H_
+
+#include <stdint.h>
+#include <memory>
+#include <vector>
+
+#include "./vec2.h"
+
+enum SamplerType {
+  // Uncorrelated random numbers.
+  kSamplerIndependent,
+  // Jittered strata over the samples of a pixel.
+  kSamplerStratified,
+  // Owen scrambled Sobol sequence.
+  kSamplerSobol,
+  // Sobol sequence shared by all pixels and shifted per pixel by a blue
+  // noise mask, which pushes the error to high frequencies.
+  kSamplerBlueNoise,
+};
+
+// Source of the sample values of a path. The values are keyed on the pixel,
+// the sample index and the dimension, i.e. the number of values drawn so far
+// by the path, plus a seed. The result doesn't depend on which thread
+// renders which pixel or in which order. Not thread safe, each thread uses
+// its own sampler.
+class Sampler {
+ public:
+  Sampler(int num_samples, uint32_t seed)
+    : num_samples_(num_samples), seed_(seed) {}
+  virtual ~Sampler() {}
+
+  // Starts or resumes the given sample of pixel (x, y).
+  void Start(int x, int y, int sample, uint32_t dimension = 0) {
+    x_ = x;
+    y_ = y;
+    sample_ = sample;
+    dimension_ = dimension;
+  }
+
+  // Number of values drawn from the current sample so far.
+  uint32_t Dimension() const { return dimension_; }
+
+  // Values in [0, 1).
+  virtual float Get1D() = 0;
+  virtual Vec2f Get2D() = 0;
+
+ protected:
+  // Uncorrelated value for the given dimension of the current sample.
+  float Uniform(uint32_t dimension) const;
+
+  int num_samples_;
+  uint32_t seed_;
+  int x_ = 0;
+  int y_ = 0;
+  int sample_ = 0;
+  uint32_t dimension_ = 0;
+};
+
+// num_samples is the expected number of samples per pixel, which the
+// stratified sampler divides the domain into.
+std::unique_ptr<Sampler> CreateSampler(SamplerType type, int num_samples,
+                                       uint32_t seed);
+
+// Side of the blue noise mask.
+const int kBlueNoiseSize = 64;
+
+// kBlueNoiseSize x kBlueNoiseSize values in [0, 1), row by row, generated
+// on first use.
+const std::vector<float>& BlueNoiseMask();
+
+#endif  // SAMPLER_H_
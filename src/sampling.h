@@ -0,0 +1,70 @@
+// Copyright 2018, Vahid Kazemi
+
+#ifndef SAMPLING_H_
+#define SAMPLING_H_
+
+#define _USE_MATH_DEFINES
+#include <math.h>
+
+#include "./vec2.h"
+#include "./vec3.h"
+
+// Closed form mappings from the unit square to other domains. They preserve
+// the stratification of the input points, unlike rejection sampling.
+
+// Shirley and Chiu's concentric mapping to the unit disk.
+inline Vec2f SampleConcentricDisk(const Vec2f& u) {
+  float x = 2 * u.x - 1;
+  float y = 2 * u.y - 1;
+  if (x == 0 && y == 0) {
+    return Vec2f(0, 0);
+  }
+  const float kQuarterPi = static_cast<float>(M_PI / 4);
+  float r, theta;
+  if (fabsf(x) > fabsf(y)) {
+    r = x;
+    theta = kQuarterPi * (y / x);
+  } else {
+    r = y;
+    theta = 2 * kQuarterPi - kQuarterPi * (x / y);
+  }
+  return Vec2f(r * cosf(theta), r * sinf(theta));
+}
+
+// Cosine weighted direction around the z axis.
+inline Vec3f SampleCosineHemisphere(const Vec2f& u) {
+  Vec2f d = SampleConcentricDisk(u);
+  float z = sqrtf(std::max(0.0f, 1 - d.x * d.x - d.y * d.y));
+  return Vec3f(d.x, d.y, z);
+}
+
+inline Vec3f SampleUniformSphere(const Vec2f& u) {
+  float z = 1 - 2 * u.x;
+  float r = sqrtf(std::max(0.0f, 1 - z * z));
+  float phi = static_cast<float>(2 * M_PI) * u.y;
+  return Vec3f(r * cosf(phi), r * sinf(phi), z);
+}
+
+// Uniform point in the unit ball.
+inline Vec3f SampleUniformBall(const Vec2f& u, float w) {
+  return SampleUniformSphere(u) * cbrtf(w);
+}
+
+// Builds an orthonormal basis (t, b, n) from a unit vector n, after
+// Duff et al., "Building an Orthonormal Basis, Revisited".
+inline void OrthonormalBasis(const Vec3f& n, Vec3f* t, Vec3f* b) {
+  float sign = copysignf(1.0f, n.z);
+  float a = -1.0f / (sign + n.z);
+  float c = n.x * n.y * a;
+  *t = Vec3f(1.0f + sign * n.x * n.x * a, sign * c, -sign * n.x);
+  *b = Vec3f(c, sign + n.y * n.y * a, -n.y);
+}
+
+// Transforms a direction from the local frame around n to world space.
+inline Vec3f ToWorld(const Vec3f& v, const Vec3f& n) {
+  Vec3f t, b;
+  OrthonormalBasis(n, &t, &b);
+  return t * v.x + b * v.y + n * v.z;
+}
+
+#endif  // SAMPLING_H_
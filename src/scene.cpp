@@ -1,28 +1,381 @@
 // Copyright 2018, Vahid Kazemi
 
 #include <float.h>
+#include <algorithm>
+#include <unordered_map>
 
+#include "./color.h"
+#include "./math.h"
 #include "./scene.h"
 
+void Object::SetTransform(const Mat4f& m) {
+  transform = m;
+  inverse = Inverse(m);
+  transformed = true;
+}
+
+bool Object::Trace(const Ray& ray, float start, float end,
+                   TraceResult* result) const {
+  if (!transformed) {
+    return geometry->Trace(ray, start, end, result);
+  }
+
+  // Geometries expect unit length directions, so the distances are scaled
+  // into object space and back.
+  Vec3f direction = TransformVector(inverse, ray.direction);
+  float scale = Length(direction);
+  Ray local(TransformPoint(inverse, ray.origin), direction / scale);
+  if (!geometry->Trace(local, start * scale, end * scale, result)) {
+    return false;
+  }
+  result->t /= scale;
+  result->position = PointAt(ray, result->t);
+  result->normal = Normal(TransformNormal(inverse, result->normal));
+  return true;
+}
+
+bool Object::Occluded(const Ray& ray, float start, float end) const {
+  if (!transformed) {
+    return geometry->Occluded(ray, start, end);
+  }
+  Vec3f direction = TransformVector(inverse, ray.direction);
+  float scale = Length(direction);
+  Ray local(TransformPoint(inverse, ray.origin), direction / scale);
+  return geometry->Occluded(local, start * scale, end * scale);
+}
+
+Bounds Object::GetBounds() const {
+  Bounds local = geometry->GetBounds();
+  if (!transformed || !geometry->Bounded()) {
+    return local;
+  }
+  Bounds bounds;
+  for (int i = 0; i < 8; ++i) {
+    Vec3f corner((i & 1) ? local.max.x : local.min.x,
+                 (i & 2) ? local.max.y : local.min.y,
+                 (i & 4) ? local.max.z : local.min.z);
+    bounds = Union(bounds, TransformPoint(transform, corner));
+  }
+  return bounds;
+}
+
 void Scene::AddObject(const Object* obj) {
   objects_.push_back(obj);
+  dirty_ = true;
 }
 
 void Scene::Clear() {
   objects_.clear();
+  dirty_ = true;
 }
 
-const Object* Scene::Trace(const Ray& ray, float start, float end,
-                           TraceResult* result) const {
-  const Object* obj = nullptr;
-  result->t = FLT_MAX;
-  for (const Object* cur_obj : objects_) {
+void Scene::Invalidate() {
+  dirty_ = true;
+}
+
+void Scene::Commit() {
+  if (!dirty_) {
+    return;
+  }
+  // Objects added more than once are compiled once, under their first id.
+  std::unordered_map<const Object*, int> ids;
+  std::unordered_map<const Material*, int> material_ids;
+  materials_.Clear();
+  material_ids_.resize(objects_.size());
+  std::vector<int> unique;
+  std::vector<int> bounded;
+  std::vector<Bounds> bounds;
+  planes_.clear();
+  plane_ids_.clear();
+  unbounded_ids_.clear();
+  for (size_t i = 0; i < objects_.size(); ++i) {
+    const Object* obj = objects_[i];
+    int id = static_cast<int>(i);
+    auto inserted = ids.emplace(obj, id);
+    if (!inserted.second) {
+      material_ids_[i] = material_ids_[inserted.first->second];
+      continue;
+    }
+    unique.push_back(id);
+    auto material = material_ids.emplace(obj->material, 0);
+    if (material.second) {
+      material.first->second = materials_.Add(*obj->material);
+    }
+    material_ids_[i] = material.first->second;
+
+    if (obj->geometry->Bounded()) {
+      bounded.push_back(id);
+      bounds.push_back(obj->GetBounds());
+      continue;
+    }
+    const Plane* plane = dynamic_cast<const Plane*>(obj->geometry);
+    if (plane && !obj->transformed) {
+      planes_.push_back(*plane);
+      plane_ids_.push_back(id);
+    } else {
+      unbounded_ids_.push_back(id);
+    }
+  }
+  bvh_.Build(bounds, SphereSet::kWidth);
+  int num_leaves = static_cast<int>(bounded.size());
+  leaf_types_.assign(num_leaves, kPrimitiveGeneric);
+  leaf_ids_.resize(num_leaves);
+  leaf_indices_.assign(num_leaves, -1);
+  spheres_.Resize(num_leaves);
+  sphere_slots_.assign(objects_.size(), -1);
+  meshes_.clear();
+  triangles_.Clear();
+  std::unordered_map<const TriangleMesh*, int> mesh_indices;
+  for (int i = 0; i < num_leaves; ++i) {
+    int id = bounded[bvh_.Primitive(i)];
+    const Object* obj = objects_[id];
+    leaf_ids_[i] = id;
+    if (obj->transformed) {
+      continue;
+    }
+    if (const Sphere* sphere = dynamic_cast<const Sphere*>(obj->geometry)) {
+      spheres_.SetSphere(i, sphere->Center(), sphere->Radius());
+      sphere_slots_[id] = i;
+      leaf_types_[i] = kPrimitiveSphere;
+    } else if (const TriangleMesh* mesh =
+               dynamic_cast<const TriangleMesh*>(obj->geometry)) {
+      auto inserted = mesh_indices.emplace(mesh,
+                                           static_cast<int>(meshes_.size()));
+      if (inserted.second) {
+        int offset = triangles_.Add(mesh->Triangles());
+        meshes_.push_back({&mesh->GetBvh(), offset});
+      }
+      leaf_indices_[i] = inserted.first->second;
+      leaf_types_[i] = kPrimitiveMesh;
+    }
+  }
+  CollectLights(unique);
+  dirty_ = false;
+}
+
+void Scene::CollectLights(const std::vector<int>& ids) {
+  lights_.clear();
+  light_cdf_.clear();
+  light_probabilities_.assign(objects_.size(), 0.0f);
+  std::vector<float> powers;
+  float total = 0;
+  for (int id : ids) {
+    const Object* obj = objects_[id];
+    float power = Luminance(materials_.Emitted(material_ids_[id])) *
+                  obj->geometry->Area();
+    if (sphere_slots_[id] < 0 || !(power > 0)) {
+      continue;
+    }
+    lights_.push_back(id);
+    powers.push_back(power);
+    total += power;
+  }
+  float sum = 0;
+  for (size_t i = 0; i < lights_.size(); ++i) {
+    light_probabilities_[lights_[i]] = powers[i] / total;
+    sum += powers[i] / total;
+    light_cdf_.push_back(sum);
+  }
+  if (!light_cdf_.empty()) {
+    light_cdf_.back() = 1;
+  }
+}
+
+int Scene::SampleLight(float u, float* probability) const {
+  float environment = EnvironmentProbability();
+  if (u < environment || lights_.empty()) {
+    *probability = environment;
+    return kNoObject;
+  }
+  u = (u - environment) / (1 - environment);
+  int i = static_cast<int>(std::upper_bound(light_cdf_.begin(),
+                                            light_cdf_.end(), u) -
+                           light_cdf_.begin());
+  i = std::min(i, static_cast<int>(lights_.size()) - 1);
+  *probability = (1 - environment) * light_probabilities_[lights_[i]];
+  return lights_[i];
+}
+
+float Scene::LightProbability(int id) const {
+  return (1 - EnvironmentProbability()) * light_probabilities_[id];
+}
+
+bool Scene::SampleLightDirection(int id, const Vec3f& point, const Vec2f& u,
+                                 DirectionSample* sample) const {
+  int slot = sphere_slots_[id];
+  return SampleSphereDirection(spheres_.Center(slot), spheres_.Radius(slot),
+                               point, u, sample);
+}
+
+float Scene::LightDirectionPdf(int id, const Vec3f& point) const {
+  int slot = sphere_slots_[id];
+  return SphereDirectionPdf(spheres_.Center(slot), spheres_.Radius(slot),
+                            point);
+}
+
+float Scene::EnvironmentProbability() const {
+  if (!environment_) {
+    return 0;
+  }
+  return lights_.empty() ? 1 : 0.5f;
+}
+
+int Scene::TraceUnbounded(const Ray& ray, float start, float end,
+                          TraceResult* result) const {
+  int id = kNoObject;
+  // The qualified call is bound statically, planes_ only holds planes.
+  for (size_t i = 0; i < planes_.size(); ++i) {
     TraceResult cur_result;
-    if (cur_obj->geometry->Trace(ray, start, end, &cur_result) &&
-        cur_result.t < result->t) {
-      obj = cur_obj;
+    if (planes_[i].Plane::Trace(ray, start, end, &cur_result)) {
+      id = plane_ids_[i];
       *result = cur_result;
+      end = cur_result.t;
+    }
+  }
+  for (int cur_id : unbounded_ids_) {
+    TraceResult cur_result;
+    if (objects_[cur_id]->Trace(ray, start, end, &cur_result)) {
+      id = cur_id;
+      *result = cur_result;
+      end = cur_result.t;
+    }
+  }
+  return id;
+}
+
+bool Scene::TraceLeaf(int i, const Ray& ray, float start, float end,
+                      TraceResult* result) const {
+  switch (leaf_types_[i]) {
+    case kPrimitiveMesh: {
+      const MeshEntry& mesh = meshes_[leaf_indices_[i]];
+      return triangles_.Trace(*mesh.bvh, mesh.offset, ray, start, end,
+                              result);
     }
+    case kPrimitiveGeneric:
+      return objects_[leaf_ids_[i]]->Trace(ray, start, end, result);
+    default:
+      return false;
   }
-  return obj;
+}
+
+bool Scene::OccludedLeaf(int i, const Ray& ray, float start,
+                         float end) const {
+  switch (leaf_types_[i]) {
+    case kPrimitiveMesh: {
+      const MeshEntry& mesh = meshes_[leaf_indices_[i]];
+      return triangles_.Occluded(*mesh.bvh, mesh.offset, ray, start, end);
+    }
+    case kPrimitiveGeneric:
+      return objects_[leaf_ids_[i]]->Occluded(ray, start, end);
+    default:
+      return false;
+  }
+}
+
+int Scene::Trace(const Ray& ray, float start, float end,
+                 TraceResult* result) const {
+  result->t = FLT_MAX;
+  int id = TraceUnbounded(ray, start, end, result);
+  if (id != kNoObject) {
+    end = result->t;
+  }
+  bvh_.Traverse(ray, start, end, [&](int first, int count, float* closest) {
+    int sphere = spheres_.Trace(ray, start, *closest, first, count, result);
+    if (sphere >= 0) {
+      id = leaf_ids_[sphere];
+      *closest = result->t;
+    }
+    for (int i = first; i < first + count; ++i) {
+      TraceResult cur_result;
+      if (TraceLeaf(i, ray, start, *closest, &cur_result)) {
+        id = leaf_ids_[i];
+        *result = cur_result;
+        *closest = cur_result.t;
+      }
+    }
+  });
+  return id;
+}
+
+bool Scene::Occluded(const Ray& ray, float start, float end) const {
+  for (const Plane& plane : planes_) {
+    if (plane.Plane::Occluded(ray, start, end)) {
+      return true;
+    }
+  }
+  for (int id : unbounded_ids_) {
+    if (objects_[id]->Occluded(ray, start, end)) {
+      return true;
+    }
+  }
+  return bvh_.TraverseAny(ray, start, end, [&](int first, int count) {
+    if (spheres_.Occluded(ray, start, end, first, count)) {
+      return true;
+    }
+    for (int i = first; i < first + count; ++i) {
+      if (OccludedLeaf(i, ray, start, end)) {
+        return true;
+      }
+    }
+    return false;
+  });
+}
+
+void Scene::Hash(Hasher* hasher) const {
+  hasher->Add(objects_.size());
+  for (const Object* obj : objects_) {
+    obj->geometry->Hash(hasher);
+    obj->material->Hash(hasher);
+    hasher->Add(obj->transform);
+  }
+  if (environment_) {
+    environment_->Hash(hasher);
+  }
+}
+
+void Scene::SetEnvironment(const Environment* environment) {
+  environment_ = environment;
+}
+
+Vec3f Scene::Background(const Ray& ray) const {
+  if (environment_) {
+    return environment_->Radiance(ray.direction);
+  }
+  float t = (ray.direction.y + 1) * 0.5;
+  return Lerp(Vec3f(1, 1, 1), Vec3f(0.3, 0.74, 1.0), t);
+}
+
+void Scene::TracePacket(const RayPacket& packet, float start, float end,
+                        int* ids, TraceResult* results) const {
+  Ray rays[RayPacket::kMaxSize];
+  alignas(32) float ends[RayPacket::kMaxSize];
+  for (int r = 0; r < packet.size; ++r) {
+    rays[r] = packet.Get(r);
+    results[r].t = FLT_MAX;
+    ids[r] = TraceUnbounded(rays[r], start, end, &results[r]);
+    ends[r] = ids[r] != kNoObject ? results[r].t : end;
+  }
+
+  bvh_.TraversePacket(packet, start, ends,
+                      [&](int first, int count, float* closest) {
+    for (int i = first; i < first + count; ++i) {
+      if (leaf_types_[i] == kPrimitiveSphere) {
+        int mask = spheres_.TracePacket(i, packet, start, closest, results);
+        for (int r = 0; mask; ++r, mask >>= 1) {
+          if (mask & 1) {
+            ids[r] = leaf_ids_[i];
+          }
+        }
+        continue;
+      }
+      for (int r = 0; r < packet.size; ++r) {
+        TraceResult cur_result;
+        if (TraceLeaf(i, rays[r], start, closest[r], &cur_result)) {
+          ids[r] = leaf_ids_[i];
+          results[r] = cur_result;
+          closest[r] = cur_result.t;
+        }
+      }
+    }
+  });
 }
@@ -3,21 +3,52 @@
 #ifndef SCENE_H_
 #define SCENE_H_
 
+#include <stdint.h>
 #include <vector>
 
+#include "./bvh.h"
+#include "./environment.h"
 #include "./geometry.h"
+#include "./mat4.h"
 #include "./material.h"
+#include "./mesh.h"
 #include "./ray.h"
+#include "./sphere_set.h"
 
+// An instance of a geometry placed in the world with a material and an
+// optional transformation. Geometries can be shared between many objects.
 struct Object {
-  Object() = default;
   Object(Geometry* geometry, Material* material)
-         : geometry(geometry), material(material) {}
+         : geometry(geometry), material(material),
+           transform(Mat4f::Identity()), inverse(Mat4f::Identity()),
+           transformed(false) {}
+
+  void SetTransform(const Mat4f& m);
+
+  // Traces the geometry in object space and reports the hit in world space.
+  bool Trace(const Ray& ray, float start, float end,
+             TraceResult* result) const;
+  bool Occluded(const Ray& ray, float start, float end) const;
+
+  // World space bounds of the object.
+  Bounds GetBounds() const;
 
   Geometry* geometry;
   Material* material;
+  Mat4f transform;
+  Mat4f inverse;
+  bool transformed;
 };
 
+// Id returned by Scene::Trace for rays which hit nothing.
+const int kNoObject = -1;
+
+// Objects are added as pointers to their description. Commit compiles them
+// into what is actually traced and shaded: dense arrays of each kind of
+// primitive under one bvh and a MaterialTable, with objects and materials
+// referred to by integer ids. Meshes keep their own bvh but their triangles
+// are copied into one array of the scene. Only transformed objects still go
+// through a virtual call of their geometry.
 class Scene {
  public:
   Scene() = default;
@@ -25,11 +56,123 @@ class Scene {
   void AddObject(const Object* obj);
   void Clear();
 
-  const Object* Trace(const Ray& ray, float start, float end,
-                      TraceResult* result) const;
+  // Marks the acceleration structure as stale, e.g. after an object moved.
+  void Invalidate();
+
+  // Builds the acceleration structure. Must be called after the scene is
+  // modified and before it is traced.
+  void Commit();
+
+  // Returns the id of the closest object hit by the ray, or kNoObject.
+  int Trace(const Ray& ray, float start, float end,
+            TraceResult* result) const;
+  // Whether anything lies on the ray between start and end. Cheaper than
+  // Trace: the search stops at the first hit and computes nothing about it.
+  bool Occluded(const Ray& ray, float start, float end) const;
+
+  // Adds the objects, their geometry, material and placement to hasher.
+  void Hash(Hasher* hasher) const;
+
+  // Object ids are the index of the first AddObject call with the object,
+  // the methods below are valid after Commit.
+  const Object* GetObject(int id) const { return objects_[id]; }
+  // Id of the material of object id in Materials().
+  int MaterialId(int id) const { return material_ids_[id]; }
+  const MaterialTable& Materials() const { return materials_; }
+
+  // Lights the scene with an environment map instead of the default sky,
+  // nullptr goes back to the sky. The map isn't copied.
+  void SetEnvironment(const Environment* environment);
+  const Environment* GetEnvironment() const { return environment_; }
+
+  // Radiance arriving along rays which leave the scene.
+  Vec3f Background(const Ray& ray) const;
+
+  // Lights which can be sampled directly: the environment map and the
+  // emissive untransformed spheres. Valid after Commit.
+  bool HasLights() const { return environment_ || !lights_.empty(); }
+  // Picks a light, emissive objects with a probability proportional to
+  // their power. Returns kNoObject when it picks the environment map.
+  int SampleLight(float u, float* probability) const;
+  // Probability of SampleLight picking object id, zero if it isn't a light.
+  float LightProbability(int id) const;
+  // Picks a direction from point towards light id, see
+  // Geometry::SampleDirection.
+  bool SampleLightDirection(int id, const Vec3f& point, const Vec2f& u,
+                            DirectionSample* sample) const;
+  // Density of SampleLightDirection choosing a direction from point which
+  // hits light id.
+  float LightDirectionPdf(int id, const Vec3f& point) const;
+  // Probability of SampleLight picking the environment map: half of the
+  // samples if there are also emissive objects, as their powers can't be
+  // compared.
+  float EnvironmentProbability() const;
+
+  // Finds the closest hit of every ray in the packet, ids[i] is set to
+  // kNoObject for the rays which miss the scene.
+  void TracePacket(const RayPacket& packet, float start, float end,
+                   int* ids, TraceResult* results) const;
 
  private:
+  // How a leaf of the bvh is traced.
+  enum PrimitiveType : uint8_t {
+    // In spheres_, a batch of them at once.
+    kPrimitiveSphere,
+    // Untransformed mesh in meshes_, its triangles are in triangles_.
+    kPrimitiveMesh,
+    // Any other object, through Object::Trace.
+    kPrimitiveGeneric,
+  };
+
+  // Fills the light list and the probabilities of picking each light from
+  // the objects ids. Needs sphere_slots_.
+  void CollectLights(const std::vector<int>& ids);
+
+  // Closest hit with the unbounded objects, returns kNoObject on a miss.
+  int TraceUnbounded(const Ray& ray, float start, float end,
+                     TraceResult* result) const;
+  // Traces leaf i of the bvh unless it is a sphere.
+  bool TraceLeaf(int i, const Ray& ray, float start, float end,
+                 TraceResult* result) const;
+  bool OccludedLeaf(int i, const Ray& ray, float start, float end) const;
+
   std::vector<const Object*> objects_;
+  MaterialTable materials_;
+  // Per object id.
+  std::vector<int> material_ids_;
+  std::vector<float> light_probabilities_;
+  std::vector<int> lights_;
+  // Running sums of the probabilities of picking each of lights_, the last
+  // one is 1.
+  std::vector<float> light_cdf_;
+
+  // Bounded objects in the order of the bvh leaves: the type of each leaf,
+  // its object id and its index in the array of its type.
+  std::vector<PrimitiveType> leaf_types_;
+  std::vector<int> leaf_ids_;
+  std::vector<int> leaf_indices_;
+  // Untransformed spheres are packed here at the index of their leaf and
+  // traced with a SIMD kernel.
+  SphereSet spheres_;
+  // Per object id, the slot of the sphere in spheres_ or -1. Lights are
+  // sampled from there.
+  std::vector<int> sphere_slots_;
+  // The bvh of a mesh and the index of its first triangle.
+  struct MeshEntry {
+    const Bvh* bvh;
+    int offset;
+  };
+  std::vector<MeshEntry> meshes_;
+  TriangleSet triangles_;
+  Bvh bvh_;
+
+  // Objects such as planes which are tested against every ray. Copies of
+  // the untransformed planes are traced without a virtual call.
+  std::vector<Plane> planes_;
+  std::vector<int> plane_ids_;
+  std::vector<int> unbounded_ids_;
+  const Environment* environment_ = nullptr;
+  bool dirty_ = false;
 };
 
 #endif  // SCENE_H_
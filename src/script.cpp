@@ -1,16 +1,28 @@
 // Copyright 2018, Vahid Kazemi
 
+#define _USE_MATH_DEFINES
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+
 extern "C" {
 # include "lua.h"
 # include "lauxlib.h"
 # include "lualib.h"
 }
 
+#include "./concurrency.h"
+#include "./mesh.h"
 #include "./script.h"
 
 #define GetFloat GetScalar<float>
 #define GetInt GetScalar<int>
 
+// Seconds between two checkpoints unless the script sets another interval.
+const double kCheckpointInterval = 60;
+
 // Common methods
 
 template<class T>
@@ -18,6 +30,11 @@ T GetScalar(lua_State *ls, int n) {
   return static_cast<T>(lua_tonumber(ls, n));
 }
 
+// Optional number argument n, or value if it is missing.
+float GetFloatOr(lua_State* ls, int n, float value) {
+  return lua_isnumber(ls, n) ? GetFloat(ls, n) : value;
+}
+
 Vec3f GetVec3f(lua_State *ls, int n) {
   return Vec3f(GetFloat(ls, n),
                GetFloat(ls, n + 1),
@@ -58,6 +75,20 @@ int NewPlane(lua_State* ls) {
   return 1;
 }
 
+int NewMesh(lua_State* ls) {
+  const char* filename = luaL_checkstring(ls, 1);
+  TriangleMesh* mesh = new TriangleMesh();
+  if (!ReadMesh(filename, mesh)) {
+    delete mesh;
+    return luaL_error(ls, "Couldn't load mesh: %s", filename);
+  }
+  Geometry* g = mesh;
+  *(Geometry**)lua_newuserdata(ls, sizeof(Geometry*)) = g;
+  luaL_getmetatable(ls, "Geometry");
+  lua_setmetatable(ls, -2);
+  return 1;
+}
+
 int GCGeometry(lua_State* ls) {
   delete GetPointer<Geometry>(ls, "Geometry", 1);
   return 0;
@@ -67,6 +98,7 @@ void RegisterGeometry(lua_State* ls) {
   luaL_Reg funcs[] = {
       { "sphere", NewSphere },
       { "plane", NewPlane },
+      { "mesh", NewMesh },
       { "__gc", GCGeometry },
       { NULL, NULL }
   };
@@ -108,6 +140,15 @@ int NewDielectric(lua_State* ls) {
   return 1;
 }
 
+int NewEmissive(lua_State* ls) {
+  Vec3f radiance = GetVec3f(ls, 1);
+  Material* material = new Emissive(radiance);
+  *(Material**)lua_newuserdata(ls, sizeof(Material*)) = material;
+  luaL_getmetatable(ls, "Material");
+  lua_setmetatable(ls, -2);
+  return 1;
+}
+
 int GCMaterial(lua_State* ls) {
   delete GetPointer<Object>(ls, "Material", 1);
   return 0;
@@ -118,6 +159,7 @@ void RegisterMaterial(lua_State* ls) {
       { "lambertian", NewLambertian },
       { "metal", NewMetal },
       { "dielectric", NewDielectric },
+      { "emissive", NewEmissive },
       { "__gc", GCMaterial },
       { NULL, NULL }
   };
@@ -141,6 +183,36 @@ int NewObject(lua_State* ls) {
   lua_setmetatable(ls, -2);
   return 1;
 }
+// Applies m on top of the current transformation of the object.
+void TransformObject(lua_State* ls, Object* obj, const Mat4f& m) {
+  obj->SetTransform(m * obj->transform);
+  Scene* scene = GetGlobalPointer<Scene>(ls, "scene_");
+  scene->Invalidate();
+}
+
+int TranslateObject(lua_State* ls) {
+  Object* obj = GetPointer<Object>(ls, "Object", 1);
+  Vec3f offset = GetVec3f(ls, 2);
+  TransformObject(ls, obj, Mat4f::Translation(offset));
+  return 0;
+}
+
+int RotateObject(lua_State* ls) {
+  Object* obj = GetPointer<Object>(ls, "Object", 1);
+  Vec3f angles = GetVec3f(ls, 2) * static_cast<float>(M_PI / 180.0);
+  TransformObject(ls, obj, Mat4f::RotationZ(angles.z) *
+                           Mat4f::RotationY(angles.y) *
+                           Mat4f::RotationX(angles.x));
+  return 0;
+}
+
+int ScaleObject(lua_State* ls) {
+  Object* obj = GetPointer<Object>(ls, "Object", 1);
+  Vec3f scale = GetVec3f(ls, 2);
+  TransformObject(ls, obj, Mat4f(scale.x, scale.y, scale.z, 1.0f));
+  return 0;
+}
+
 int GCObject(lua_State* ls) {
   delete GetPointer<Object>(ls, "Object", 1);
   return 0;
@@ -149,6 +221,9 @@ int GCObject(lua_State* ls) {
 void RegisterObject(lua_State* ls) {
   luaL_Reg funcs[] = {
       { "new", NewObject },
+      { "translate", TranslateObject },
+      { "rotate", RotateObject },
+      { "scale", ScaleObject },
       { "__gc", GCObject },
       { NULL, NULL }
   };
@@ -171,6 +246,202 @@ int SetSize(lua_State* ls) {
   return 0;
 }
 
+// set_region(x0, y0, x1, y1) limits renders to a rectangle of the image,
+// set_region() renders the whole image again.
+int SetRegion(lua_State* ls) {
+  Pathtracer* pathtracer = GetGlobalPointer<Pathtracer>(ls, "pathtracer_");
+  if (lua_gettop(ls) == 0) {
+    pathtracer->SetRegion(0, 0, 0, 0);
+    return 0;
+  }
+  pathtracer->SetRegion(GetInt(ls, 1), GetInt(ls, 2), GetInt(ls, 3),
+                        GetInt(ls, 4));
+  return 0;
+}
+
+int SetSamples(lua_State* ls) {
+  int num_samples = GetInt(ls, 1);
+
+  Pathtracer* pathtracer = GetGlobalPointer<Pathtracer>(ls, "pathtracer_");
+  pathtracer->SetSamples(num_samples);
+  return 0;
+}
+
+int SetMaxDepth(lua_State* ls) {
+  int max_depth = GetInt(ls, 1);
+
+  Pathtracer* pathtracer = GetGlobalPointer<Pathtracer>(ls, "pathtracer_");
+  pathtracer->SetMaxDepth(max_depth);
+  return 0;
+}
+
+int SetRoulette(lua_State* ls) {
+  int min_depth = GetInt(ls, 1);
+  float threshold = GetFloatOr(ls, 2, kRouletteThreshold);
+
+  Pathtracer* pathtracer = GetGlobalPointer<Pathtracer>(ls, "pathtracer_");
+  pathtracer->SetRoulette(min_depth, threshold);
+  return 0;
+}
+
+int SetPacketSize(lua_State* ls) {
+  int packet_size = GetInt(ls, 1);
+
+  Pathtracer* pathtracer = GetGlobalPointer<Pathtracer>(ls, "pathtracer_");
+  pathtracer->SetPacketSize(packet_size);
+  return 0;
+}
+
+int SetIntegrator(lua_State* ls) {
+  const char* name = luaL_checkstring(ls, 1);
+
+  Integrator integrator;
+  if (strcmp(name, "recursive") == 0) {
+    integrator = kIntegratorRecursive;
+  } else if (strcmp(name, "wavefront") == 0) {
+    integrator = kIntegratorWavefront;
+  } else {
+    return luaL_error(ls, "Unknown integrator: %s", name);
+  }
+
+  Pathtracer* pathtracer = GetGlobalPointer<Pathtracer>(ls, "pathtracer_");
+  pathtracer->SetIntegrator(integrator);
+  return 0;
+}
+
+int SetAdaptive(lua_State* ls) {
+  int min_samples = GetInt(ls, 1);
+  int max_samples = GetInt(ls, 2);
+  float threshold = GetFloat(ls, 3);
+
+  Pathtracer* pathtracer = GetGlobalPointer<Pathtracer>(ls, "pathtracer_");
+  pathtracer->SetAdaptive(min_samples, max_samples, threshold);
+  return 0;
+}
+
+int SetProgressive(lua_State* ls) {
+  int pass_samples = GetInt(ls, 1);
+  int max_samples = GetInt(ls, 2);
+  double time_budget = GetScalar<double>(ls, 3);
+
+  Pathtracer* pathtracer = GetGlobalPointer<Pathtracer>(ls, "pathtracer_");
+  pathtracer->SetProgressive(pass_samples, max_samples, time_budget);
+  return 0;
+}
+
+int SetCheckpoint(lua_State* ls) {
+  const char* filename = lua_tostring(ls, 1);
+  double interval = lua_isnumber(ls, 2) ? GetScalar<double>(ls, 2)
+                                        : kCheckpointInterval;
+
+  Pathtracer* pathtracer = GetGlobalPointer<Pathtracer>(ls, "pathtracer_");
+  pathtracer->SetCheckpoint(filename ? filename : "", interval);
+  return 0;
+}
+
+int SetDenoise(lua_State* ls) {
+  int iterations = GetInt(ls, 1);
+  float sigma_color = GetFloatOr(ls, 2, kDenoiseSigmaColor);
+  float sigma_normal = GetFloatOr(ls, 3, kDenoiseSigmaNormal);
+  float sigma_depth = GetFloatOr(ls, 4, kDenoiseSigmaDepth);
+  float sigma_albedo = GetFloatOr(ls, 5, kDenoiseSigmaAlbedo);
+
+  Pathtracer* pathtracer = GetGlobalPointer<Pathtracer>(ls, "pathtracer_");
+  pathtracer->SetDenoise(iterations, sigma_color, sigma_normal, sigma_depth,
+                         sigma_albedo);
+  return 0;
+}
+
+int SetSampler(lua_State* ls) {
+  const char* name = luaL_checkstring(ls, 1);
+
+  SamplerType sampler;
+  if (strcmp(name, "independent") == 0) {
+    sampler = kSamplerIndependent;
+  } else if (strcmp(name, "stratified") == 0) {
+    sampler = kSamplerStratified;
+  } else if (strcmp(name, "sobol") == 0) {
+    sampler = kSamplerSobol;
+  } else if (strcmp(name, "bluenoise") == 0) {
+    sampler = kSamplerBlueNoise;
+  } else {
+    return luaL_error(ls, "Unknown sampler: %s", name);
+  }
+
+  Pathtracer* pathtracer = GetGlobalPointer<Pathtracer>(ls, "pathtracer_");
+  pathtracer->SetSampler(sampler);
+  return 0;
+}
+
+int SetSeed(lua_State* ls) {
+  uint32_t seed = static_cast<uint32_t>(lua_tointeger(ls, 1));
+
+  Pathtracer* pathtracer = GetGlobalPointer<Pathtracer>(ls, "pathtracer_");
+  pathtracer->SetSeed(seed);
+  return 0;
+}
+
+int SetExposure(lua_State* ls) {
+  float stops = GetFloat(ls, 1);
+
+  PostProcess* post = GetGlobalPointer<PostProcess>(ls, "post_");
+  post->SetExposure(stops);
+  return 0;
+}
+
+int SetTonemap(lua_State* ls) {
+  const char* name = luaL_checkstring(ls, 1);
+
+  Tonemap tonemap;
+  if (strcmp(name, "clamp") == 0) {
+    tonemap = kTonemapClamp;
+  } else if (strcmp(name, "reinhard") == 0) {
+    tonemap = kTonemapReinhard;
+  } else if (strcmp(name, "aces") == 0) {
+    tonemap = kTonemapAces;
+  } else {
+    return luaL_error(ls, "Unknown tonemap: %s", name);
+  }
+
+  PostProcess* post = GetGlobalPointer<PostProcess>(ls, "post_");
+  post->SetTonemap(tonemap);
+  return 0;
+}
+
+// Takes a number or "srgb".
+int SetGamma(lua_State* ls) {
+  float gamma;
+  if (lua_isnumber(ls, 1)) {
+    gamma = GetFloat(ls, 1);
+  } else if (strcmp(luaL_checkstring(ls, 1), "srgb") == 0) {
+    gamma = 0;
+  } else {
+    return luaL_error(ls, "Gamma must be a number or \"srgb\"");
+  }
+
+  PostProcess* post = GetGlobalPointer<PostProcess>(ls, "post_");
+  post->SetGamma(gamma);
+  return 0;
+}
+
+int SetDither(lua_State* ls) {
+  bool dither = lua_toboolean(ls, 1);
+
+  PostProcess* post = GetGlobalPointer<PostProcess>(ls, "post_");
+  post->SetDither(dither);
+  return 0;
+}
+
+int SetThreads(lua_State* ls) {
+  int num_threads = GetInt(ls, 1);
+  // Queued images are post processed on the pool, which can't be resized
+  // while they run.
+  ImageWriter* writer = GetGlobalPointer<ImageWriter>(ls, "writer_");
+  writer->Flush();
+  ThreadPool::Default().SetNumThreads(num_threads);
+  return 0;
+}
+
 int SetPerspective(lua_State* ls) {
   float fovy = GetFloat(ls, 1);
   float aspect = GetFloat(ls, 2);
@@ -198,6 +469,22 @@ int Clear(lua_State* ls) {
   return 0;
 }
 
+int SetEnvironment(lua_State* ls) {
+  Scene* scene = GetGlobalPointer<Scene>(ls, "scene_");
+  if (lua_isnoneornil(ls, 1)) {
+    scene->SetEnvironment(nullptr);
+    return 0;
+  }
+  const char* filename = luaL_checkstring(ls, 1);
+  Environment* environment = GetGlobalPointer<Environment>(ls,
+                                                           "environment_");
+  if (!environment->Load(filename)) {
+    return luaL_error(ls, "Couldn't load environment map: %s", filename);
+  }
+  scene->SetEnvironment(environment);
+  return 0;
+}
+
 int AddObject(lua_State* ls) {
   Object* obj = GetPointer<Object>(ls, "Object", 1);
   Scene* scene = GetGlobalPointer<Scene>(ls, "scene_");
@@ -205,15 +492,180 @@ int AddObject(lua_State* ls) {
   return 0;
 }
 
+// Renders a frame and queues it to be written to a file and/or a stream.
+// In progressive mode the file is also written every write_every passes.
+int RenderFrame(lua_State* ls, const char* filename, int write_every,
+                VideoStream* stream) {
+  Pathtracer* pathtracer = GetGlobalPointer<Pathtracer>(ls, "pathtracer_");
+  Scene* scene = GetGlobalPointer<Scene>(ls, "scene_");
+  Camera* camera = GetGlobalPointer<Camera>(ls, "camera_");
+  ImageWriter* writer = GetGlobalPointer<ImageWriter>(ls, "writer_");
+  PostProcess* post = GetGlobalPointer<PostProcess>(ls, "post_");
+
+  // Committing the scene, mostly building its bvh, is timed apart from
+  // tracing since it grows differently with the size of the scene.
+  auto start = std::chrono::steady_clock::now();
+  scene->Commit();
+  std::chrono::duration<double> commit_elapsed =
+    std::chrono::steady_clock::now() - start;
+
+  start = std::chrono::steady_clock::now();
+  Pathtracer::PassCallback on_pass;
+  if (filename && write_every > 0) {
+    on_pass = [&](int pass, const Image<Vec3f>& radiance) {
+      if (pass % write_every == 0) {
+        writer->Write(filename, radiance, *post);
+      }
+    };
+  }
+  const Image<Vec3f>& radiance = pathtracer->Render(*scene, *camera,
+                                                    on_pass);
+  std::chrono::duration<double> elapsed =
+    std::chrono::steady_clock::now() - start;
+
+  // The image is encoded in the background while the next frame renders.
+  if (filename) {
+    writer->Write(filename, radiance, *post);
+  }
+  if (stream) {
+    writer->Write(stream, radiance, *post);
+  }
+
+  if (pathtracer->Adaptive() || pathtracer->Progressive()) {
+    // Not on stdout, which may carry the video stream.
+    fprintf(stderr, "Average samples per pixel: %.2f\n",
+            pathtracer->AverageSamples());
+  }
+
+  // Return the time spent tracing in seconds, the samples per pixel, the
+  // total time spent writing images so far and the time spent preparing the
+  // scene.
+  lua_pushnumber(ls, elapsed.count());
+  lua_pushnumber(ls, pathtracer->AverageSamples());
+  lua_pushnumber(ls, writer->EncodeTime());
+  lua_pushnumber(ls, commit_elapsed.count());
+  return 4;
+}
+
 int Render(lua_State* ls) {
   const char* filename = lua_tostring(ls, 1);
+  int write_every = GetInt(ls, 2);
+  return RenderFrame(ls, filename, write_every, nullptr);
+}
+
+// Renders an image too large for memory through a TiledFramebuffer kept in
+// filename.tiles next to the output, which is deleted once it is written.
+int RenderTiled(lua_State* ls) {
+  const char* filename = luaL_checkstring(ls, 1);
+  int tile_size = lua_isnumber(ls, 2) ? GetInt(ls, 2) : kFramebufferTileSize;
 
   Pathtracer* pathtracer = GetGlobalPointer<Pathtracer>(ls, "pathtracer_");
   Scene* scene = GetGlobalPointer<Scene>(ls, "scene_");
   Camera* camera = GetGlobalPointer<Camera>(ls, "camera_");
+  PostProcess* post = GetGlobalPointer<PostProcess>(ls, "post_");
+
+  std::string tiles_file = std::string(filename) + ".tiles";
+  TiledFramebuffer framebuffer;
+  if (!framebuffer.Open(tiles_file.c_str(), pathtracer->Width(),
+                        pathtracer->Height(), tile_size)) {
+    return luaL_error(ls, "Couldn't open framebuffer: %s",
+                      tiles_file.c_str());
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  scene->Commit();
+  std::chrono::duration<double> commit_elapsed =
+    std::chrono::steady_clock::now() - start;
+
+  start = std::chrono::steady_clock::now();
+  float samples = pathtracer->RenderTiled(*scene, *camera, &framebuffer);
+  std::chrono::duration<double> elapsed =
+    std::chrono::steady_clock::now() - start;
+  bool written = framebuffer.Write(filename, *post);
+  // luaL_error doesn't return, so the backing file is removed first.
+  framebuffer.Close();
+  if (!written) {
+    return luaL_error(ls, "Couldn't write image: %s", filename);
+  }
+
+  // Return the time spent tracing in seconds, the samples per pixel and the
+  // time spent preparing the scene.
+  lua_pushnumber(ls, elapsed.count());
+  lua_pushnumber(ls, samples);
+  lua_pushnumber(ls, commit_elapsed.count());
+  return 3;
+}
+
+int WriteAov(lua_State* ls) {
+  const char* name = luaL_checkstring(ls, 1);
+  const char* filename = luaL_checkstring(ls, 2);
+
+  Aov aov;
+  if (strcmp(name, "normal") == 0) {
+    aov = kAovNormal;
+  } else if (strcmp(name, "depth") == 0) {
+    aov = kAovDepth;
+  } else if (strcmp(name, "albedo") == 0) {
+    aov = kAovAlbedo;
+  } else if (strcmp(name, "object_id") == 0) {
+    aov = kAovObjectId;
+  } else if (strcmp(name, "samples") == 0) {
+    aov = kAovSampleCount;
+  } else if (strcmp(name, "variance") == 0) {
+    aov = kAovVariance;
+  } else {
+    return luaL_error(ls, "Unknown AOV: %s", name);
+  }
+
+  Pathtracer* pathtracer = GetGlobalPointer<Pathtracer>(ls, "pathtracer_");
+  ImageWriter* writer = GetGlobalPointer<ImageWriter>(ls, "writer_");
+  // HDR files get the raw values, 8 bit ones values mapped to [0, 1]
+  // without gamma correction.
+  Image<Vec3f> image;
+  pathtracer->GetAov(aov, !IsHdrFilename(filename), &image);
+  PostProcess linear;
+  linear.SetGamma(1.0f);
+  writer->Write(filename, image, linear);
+  return 0;
+}
+
+int WriteLastImage(lua_State* ls) {
+  const char* filename = luaL_checkstring(ls, 1);
 
-  const Image<RGBA>& image = pathtracer->Render(*scene, *camera);
-  WriteImage(filename, image);
+  Pathtracer* pathtracer = GetGlobalPointer<Pathtracer>(ls, "pathtracer_");
+  ImageWriter* writer = GetGlobalPointer<ImageWriter>(ls, "writer_");
+  PostProcess* post = GetGlobalPointer<PostProcess>(ls, "post_");
+  writer->Write(filename, pathtracer->Output(), *post);
+  return 0;
+}
+
+int OpenStream(lua_State* ls) {
+  const char* filename = luaL_checkstring(ls, 1);
+  int fps = lua_isnumber(ls, 2) ? GetInt(ls, 2) : 30;
+  bool frame_index = lua_toboolean(ls, 3);
+
+  VideoStream* stream = GetGlobalPointer<VideoStream>(ls, "stream_");
+  ImageWriter* writer = GetGlobalPointer<ImageWriter>(ls, "writer_");
+  writer->Flush();
+  if (!stream->Open(filename, fps, frame_index)) {
+    return luaL_error(ls, "Couldn't open stream: %s", filename);
+  }
+  return 0;
+}
+
+int RenderToStream(lua_State* ls) {
+  VideoStream* stream = GetGlobalPointer<VideoStream>(ls, "stream_");
+  if (!stream->IsOpen()) {
+    return luaL_error(ls, "No stream is open, call open_stream first.");
+  }
+  return RenderFrame(ls, nullptr, 0, stream);
+}
+
+int CloseStream(lua_State* ls) {
+  VideoStream* stream = GetGlobalPointer<VideoStream>(ls, "stream_");
+  ImageWriter* writer = GetGlobalPointer<ImageWriter>(ls, "writer_");
+  writer->Flush();
+  stream->Close();
   return 0;
 }
 
@@ -233,11 +685,35 @@ Script::Script()
 
   // Register functions
   lua_register(lua_state_, "set_size", SetSize);
+  lua_register(lua_state_, "set_region", SetRegion);
+  lua_register(lua_state_, "set_samples", SetSamples);
+  lua_register(lua_state_, "set_max_depth", SetMaxDepth);
+  lua_register(lua_state_, "set_roulette", SetRoulette);
+  lua_register(lua_state_, "set_packet_size", SetPacketSize);
+  lua_register(lua_state_, "set_integrator", SetIntegrator);
+  lua_register(lua_state_, "set_threads", SetThreads);
+  lua_register(lua_state_, "set_adaptive", SetAdaptive);
+  lua_register(lua_state_, "set_progressive", SetProgressive);
+  lua_register(lua_state_, "set_checkpoint", SetCheckpoint);
+  lua_register(lua_state_, "set_denoise", SetDenoise);
+  lua_register(lua_state_, "set_sampler", SetSampler);
+  lua_register(lua_state_, "set_seed", SetSeed);
+  lua_register(lua_state_, "set_exposure", SetExposure);
+  lua_register(lua_state_, "set_tonemap", SetTonemap);
+  lua_register(lua_state_, "set_gamma", SetGamma);
+  lua_register(lua_state_, "set_dither", SetDither);
   lua_register(lua_state_, "set_perspective", SetPerspective);
   lua_register(lua_state_, "look_at", LookAt);
   lua_register(lua_state_, "clear", Clear);
   lua_register(lua_state_, "add_object", AddObject);
+  lua_register(lua_state_, "set_environment", SetEnvironment);
   lua_register(lua_state_, "render", Render);
+  lua_register(lua_state_, "render_tiled", RenderTiled);
+  lua_register(lua_state_, "write_image", WriteLastImage);
+  lua_register(lua_state_, "write_aov", WriteAov);
+  lua_register(lua_state_, "open_stream", OpenStream);
+  lua_register(lua_state_, "render_to_stream", RenderToStream);
+  lua_register(lua_state_, "close_stream", CloseStream);
 
   // Push global variables
   lua_pushlightuserdata(lua_state_, &pathtracer_);
@@ -246,14 +722,34 @@ Script::Script()
   lua_pushlightuserdata(lua_state_, &scene_);
   lua_setglobal(lua_state_, "scene_");
 
+  lua_pushlightuserdata(lua_state_, &environment_);
+  lua_setglobal(lua_state_, "environment_");
+
   lua_pushlightuserdata(lua_state_, &camera_);
   lua_setglobal(lua_state_, "camera_");
+
+  lua_pushlightuserdata(lua_state_, &post_);
+  lua_setglobal(lua_state_, "post_");
+
+  lua_pushlightuserdata(lua_state_, &stream_);
+  lua_setglobal(lua_state_, "stream_");
+
+  lua_pushlightuserdata(lua_state_, &writer_);
+  lua_setglobal(lua_state_, "writer_");
 }
 
 Script::~Script() {
   lua_close(lua_state_);
 }
 
+bool Script::Resume(const char* checkpoint) {
+  if (!pathtracer_.LoadCheckpoint(checkpoint)) {
+    return false;
+  }
+  pathtracer_.SetCheckpoint(checkpoint, kCheckpointInterval);
+  return true;
+}
+
 bool Script::Run(const char* filename) {
   int status = luaL_loadfile(lua_state_, filename);
   if (status) {
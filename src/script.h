@@ -7,20 +7,31 @@ extern "C" {
 #include <lua.h>
 }
 
+#include "./environment.h"
+#include "./image_writer.h"
 #include "./pathtracer.h"
+#include "./postprocess.h"
+#include "./video_stream.h"
 
 class Script {
  public:
   Script();
   ~Script();
 
+  // Continues the first render from a checkpoint and keeps saving to it.
+  bool Resume(const char* checkpoint);
   bool Run(const char* filename);
 
  private:
   lua_State* lua_state_;
   Pathtracer pathtracer_;
   Scene scene_;
+  Environment environment_;
   Camera camera_;
+  PostProcess post_;
+  VideoStream stream_;
+  // Declared last so that it finishes writing before the stream closes.
+  ImageWriter writer_;
 };
 
 #endif  // SCRIPT_H_
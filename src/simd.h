@@ -0,0 +1,135 @@
+// Copyright 2018, Vahid Kazemi
+
+#ifndef SIMD_H_
+#define SIMD_H_
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Thin wrappers around the widest float vector type available at compile
+// time. Comparisons return masks with all bits of the matching lanes set.
+// The scalar fallback keeps the same interface with a single lane.
+namespace simd {
+
+#if defined(__AVX__)
+
+const int kWidth = 8;
+typedef __m256 Float;
+
+inline Float Set(float f) { return _mm256_set1_ps(f); }
+inline Float Load(const float* p) { return _mm256_loadu_ps(p); }
+inline void Store(float* p, Float a) { _mm256_storeu_ps(p, a); }
+inline Float Add(Float a, Float b) { return _mm256_add_ps(a, b); }
+inline Float Sub(Float a, Float b) { return _mm256_sub_ps(a, b); }
+inline Float Mul(Float a, Float b) { return _mm256_mul_ps(a, b); }
+inline Float Div(Float a, Float b) { return _mm256_div_ps(a, b); }
+inline Float Sqrt(Float a) { return _mm256_sqrt_ps(a); }
+inline Float Min(Float a, Float b) { return _mm256_min_ps(a, b); }
+inline Float Max(Float a, Float b) { return _mm256_max_ps(a, b); }
+inline Float And(Float a, Float b) { return _mm256_and_ps(a, b); }
+inline Float AndNot(Float a, Float b) { return _mm256_andnot_ps(a, b); }
+inline Float Or(Float a, Float b) { return _mm256_or_ps(a, b); }
+inline Float Greater(Float a, Float b) {
+  return _mm256_cmp_ps(a, b, _CMP_GT_OQ);
+}
+inline Float Less(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+inline Float Equal(Float a, Float b) {
+  return _mm256_cmp_ps(a, b, _CMP_EQ_OQ);
+}
+inline int MoveMask(Float a) { return _mm256_movemask_ps(a); }
+// Lane i holds start + i.
+inline Float Ramp(float start) {
+  return _mm256_add_ps(_mm256_set1_ps(start),
+                       _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7));
+}
+
+#elif defined(__SSE2__)
+
+const int kWidth = 4;
+typedef __m128 Float;
+
+inline Float Set(float f) { return _mm_set1_ps(f); }
+inline Float Load(const float* p) { return _mm_loadu_ps(p); }
+inline void Store(float* p, Float a) { _mm_storeu_ps(p, a); }
+inline Float Add(Float a, Float b) { return _mm_add_ps(a, b); }
+inline Float Sub(Float a, Float b) { return _mm_sub_ps(a, b); }
+inline Float Mul(Float a, Float b) { return _mm_mul_ps(a, b); }
+inline Float Div(Float a, Float b) { return _mm_div_ps(a, b); }
+inline Float Sqrt(Float a) { return _mm_sqrt_ps(a); }
+inline Float Min(Float a, Float b) { return _mm_min_ps(a, b); }
+inline Float Max(Float a, Float b) { return _mm_max_ps(a, b); }
+inline Float And(Float a, Float b) { return _mm_and_ps(a, b); }
+inline Float AndNot(Float a, Float b) { return _mm_andnot_ps(a, b); }
+inline Float Or(Float a, Float b) { return _mm_or_ps(a, b); }
+inline Float Greater(Float a, Float b) { return _mm_cmpgt_ps(a, b); }
+inline Float Less(Float a, Float b) { return _mm_cmplt_ps(a, b); }
+inline Float Equal(Float a, Float b) { return _mm_cmpeq_ps(a, b); }
+inline int MoveMask(Float a) { return _mm_movemask_ps(a); }
+inline Float Ramp(float start) {
+  return _mm_add_ps(_mm_set1_ps(start), _mm_setr_ps(0, 1, 2, 3));
+}
+
+#else
+
+const int kWidth = 1;
+typedef float Float;
+
+inline uint32_t Bits(Float a) {
+  uint32_t u;
+  memcpy(&u, &a, sizeof(u));
+  return u;
+}
+inline Float FromBits(uint32_t u) {
+  Float a;
+  memcpy(&a, &u, sizeof(a));
+  return a;
+}
+inline Float Mask(bool b) { return FromBits(b ? 0xffffffffu : 0u); }
+
+inline Float Set(float f) { return f; }
+inline Float Load(const float* p) { return *p; }
+inline void Store(float* p, Float a) { *p = a; }
+inline Float Add(Float a, Float b) { return a + b; }
+inline Float Sub(Float a, Float b) { return a - b; }
+inline Float Mul(Float a, Float b) { return a * b; }
+inline Float Div(Float a, Float b) { return a / b; }
+inline Float Sqrt(Float a) { return sqrtf(a); }
+inline Float Min(Float a, Float b) { return a < b ? a : b; }
+inline Float Max(Float a, Float b) { return a > b ? a : b; }
+inline Float And(Float a, Float b) { return FromBits(Bits(a) & Bits(b)); }
+inline Float AndNot(Float a, Float b) { return FromBits(~Bits(a) & Bits(b)); }
+inline Float Or(Float a, Float b) { return FromBits(Bits(a) | Bits(b)); }
+inline Float Greater(Float a, Float b) { return Mask(a > b); }
+inline Float Less(Float a, Float b) { return Mask(a < b); }
+inline Float Equal(Float a, Float b) { return Mask(a == b); }
+inline int MoveMask(Float a) { return Bits(a) >> 31; }
+inline Float Ramp(float start) { return start; }
+
+#endif
+
+// Picks a where the mask is set and b elsewhere.
+inline Float Select(Float mask, Float a, Float b) {
+  return Or(And(mask, a), AndNot(mask, b));
+}
+
+// Returns the smallest value across all lanes.
+inline float ReduceMin(Float a) {
+  float lanes[kWidth];
+  Store(lanes, a);
+  float m = lanes[0];
+  for (int i = 1; i < kWidth; ++i) {
+    m = lanes[i] < m ? lanes[i] : m;
+  }
+  return m;
+}
+
+}  // namespace simd
+
+#endif  // SIMD_H_
@@ -0,0 +1,183 @@
+// Copyright 2018, Vahid Kazemi
+
+#include <float.h>
+#include <math.h>
+
+#include "./sphere_set.h"
+
+void SphereSet::Resize(int size) {
+  // Pad the arrays so that the kernel can always load full vectors.
+  int padded = size + kWidth;
+  center_x_.assign(padded, 0.0f);
+  center_y_.assign(padded, 0.0f);
+  center_z_.assign(padded, 0.0f);
+  radius_.assign(padded, 0.0f);
+  // An infinitely negative squared radius makes the discriminant negative.
+  squared_radius_.assign(padded, -INFINITY);
+}
+
+void SphereSet::SetSphere(int i, const Vec3f& center, float radius) {
+  center_x_[i] = center.x;
+  center_y_[i] = center.y;
+  center_z_[i] = center.z;
+  radius_[i] = radius;
+  squared_radius_[i] = radius * radius;
+}
+
+int SphereSet::Trace(const Ray& ray, float start, float end,
+                     int first, int count, TraceResult* result) const {
+  using namespace simd;  // NOLINT
+
+  // Same operations in the same order as Sphere::Trace so that the results
+  // match within float rounding. The compiler may fuse multiplies and adds
+  // differently in the two, e.g. with -march=native.
+  const Float ox = Set(ray.origin.x);
+  const Float oy = Set(ray.origin.y);
+  const Float oz = Set(ray.origin.z);
+  const Float dx = Set(ray.direction.x);
+  const Float dy = Set(ray.direction.y);
+  const Float dz = Set(ray.direction.z);
+  const Float vstart = Set(start);
+  const Float zero = Set(0.0f);
+  const Float inf = Set(INFINITY);
+
+  int best = -1;
+  float best_t = end;
+  float best_sign = 1.0f;
+  for (int i = first; i < first + count; i += kWidth) {
+    Float vend = Set(best_t);
+    Float vx = Sub(Load(&center_x_[i]), ox);
+    Float vy = Sub(Load(&center_y_[i]), oy);
+    Float vz = Sub(Load(&center_z_[i]), oz);
+    Float b = Add(Add(Mul(dx, vx), Mul(dy, vy)), Mul(dz, vz));
+    Float c = Sub(Add(Add(Mul(vx, vx), Mul(vy, vy)), Mul(vz, vz)),
+                  Load(&squared_radius_[i]));
+    Float d = Sub(Mul(b, b), c);
+    Float valid = And(Greater(d, zero),
+                      Less(Ramp(static_cast<float>(i)),
+                           Set(static_cast<float>(first + count))));
+    Float sqrt_d = Sqrt(d);
+    Float t0 = Sub(b, sqrt_d);
+    Float t1 = Add(b, sqrt_d);
+    Float near = And(Greater(t0, vstart), Less(t0, vend));
+    Float far = And(Greater(t1, vstart), Less(t1, vend));
+    Float hit = And(valid, Or(near, far));
+    if (MoveMask(hit) == 0) {
+      continue;
+    }
+
+    Float t = Select(hit, Select(near, t0, t1), inf);
+    float min_t = ReduceMin(t);
+    // Lowest lane wins ties, as in a sequential loop.
+    int lane = __builtin_ctz(MoveMask(Equal(t, Set(min_t))));
+    best = i + lane;
+    best_t = min_t;
+    best_sign = (MoveMask(near) >> lane) & 1 ? 1.0f : -1.0f;
+  }
+
+  if (best < 0) {
+    return -1;
+  }
+
+  Vec3f center(center_x_[best], center_y_[best], center_z_[best]);
+  Vec3f p = PointAt(ray, best_t);
+  result->t = best_t;
+  result->position = p;
+  result->normal = best_sign * (p - center) / radius_[best];
+  return best;
+}
+
+bool SphereSet::Occluded(const Ray& ray, float start, float end,
+                         int first, int count) const {
+  using namespace simd;  // NOLINT
+
+  const Float ox = Set(ray.origin.x);
+  const Float oy = Set(ray.origin.y);
+  const Float oz = Set(ray.origin.z);
+  const Float dx = Set(ray.direction.x);
+  const Float dy = Set(ray.direction.y);
+  const Float dz = Set(ray.direction.z);
+  const Float vstart = Set(start);
+  const Float vend = Set(end);
+  const Float zero = Set(0.0f);
+
+  for (int i = first; i < first + count; i += kWidth) {
+    Float vx = Sub(Load(&center_x_[i]), ox);
+    Float vy = Sub(Load(&center_y_[i]), oy);
+    Float vz = Sub(Load(&center_z_[i]), oz);
+    Float b = Add(Add(Mul(dx, vx), Mul(dy, vy)), Mul(dz, vz));
+    Float c = Sub(Add(Add(Mul(vx, vx), Mul(vy, vy)), Mul(vz, vz)),
+                  Load(&squared_radius_[i]));
+    Float d = Sub(Mul(b, b), c);
+    Float valid = And(Greater(d, zero),
+                      Less(Ramp(static_cast<float>(i)),
+                           Set(static_cast<float>(first + count))));
+    Float sqrt_d = Sqrt(d);
+    Float t0 = Sub(b, sqrt_d);
+    Float t1 = Add(b, sqrt_d);
+    Float near = And(Greater(t0, vstart), Less(t0, vend));
+    Float far = And(Greater(t1, vstart), Less(t1, vend));
+    if (MoveMask(And(valid, Or(near, far))) != 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+int SphereSet::TracePacket(int i, const RayPacket& packet, float start,
+                           float* ends, TraceResult* results) const {
+  using namespace simd;  // NOLINT
+
+  const Float cx = Set(center_x_[i]);
+  const Float cy = Set(center_y_[i]);
+  const Float cz = Set(center_z_[i]);
+  const Float squared_radius = Set(squared_radius_[i]);
+  const Float vstart = Set(start);
+  const Float zero = Set(0.0f);
+
+  int mask = 0;
+  for (int r = 0; r < packet.size; r += kWidth) {
+    Float dx = Load(&packet.direction_x[r]);
+    Float dy = Load(&packet.direction_y[r]);
+    Float dz = Load(&packet.direction_z[r]);
+    Float vend = Load(&ends[r]);
+    Float vx = Sub(cx, Load(&packet.origin_x[r]));
+    Float vy = Sub(cy, Load(&packet.origin_y[r]));
+    Float vz = Sub(cz, Load(&packet.origin_z[r]));
+    Float b = Add(Add(Mul(dx, vx), Mul(dy, vy)), Mul(dz, vz));
+    Float c = Sub(Add(Add(Mul(vx, vx), Mul(vy, vy)), Mul(vz, vz)),
+                  squared_radius);
+    Float d = Sub(Mul(b, b), c);
+    Float valid = And(Greater(d, zero),
+                      Less(Ramp(static_cast<float>(r)),
+                           Set(static_cast<float>(packet.size))));
+    Float sqrt_d = Sqrt(d);
+    Float t0 = Sub(b, sqrt_d);
+    Float t1 = Add(b, sqrt_d);
+    Float near = And(Greater(t0, vstart), Less(t0, vend));
+    Float far = And(Greater(t1, vstart), Less(t1, vend));
+    int hit = MoveMask(And(valid, Or(near, far)));
+    if (hit == 0) {
+      continue;
+    }
+
+    alignas(32) float t[kWidth];
+    Store(t, Select(near, t0, t1));
+    int near_mask = MoveMask(near);
+    Vec3f center(center_x_[i], center_y_[i], center_z_[i]);
+    for (int lane = 0; lane < kWidth; ++lane) {
+      if (!((hit >> lane) & 1)) {
+        continue;
+      }
+      int k = r + lane;
+      float sign = (near_mask >> lane) & 1 ? 1.0f : -1.0f;
+      Vec3f p = PointAt(packet.Get(k), t[lane]);
+      ends[k] = t[lane];
+      results[k].t = t[lane];
+      results[k].position = p;
+      results[k].normal = sign * (p - center) / radius_[i];
+    }
+    mask |= hit << r;
+  }
+  return mask;
+}
@@ -0,0 +1,54 @@
+// Copyright 2018, Vahid Kazemi
+
+#ifndef SPHERE_SET_H_
+#define SPHERE_SET_H_
+
+#include "./aligned.h"
+#include "./geometry.h"
+#include "./ray.h"
+#include "./simd.h"
+#include "./vec3.h"
+
+// Spheres packed in structure of arrays layout so that one ray can be
+// tested against several spheres at a time with SIMD instructions.
+// Slots can be left empty, these never report a hit.
+class SphereSet {
+ public:
+  // Number of spheres tested by one kernel invocation.
+  static const int kWidth = simd::kWidth;
+
+  SphereSet() = default;
+
+  // Allocates the given number of empty slots.
+  void Resize(int size);
+  void SetSphere(int i, const Vec3f& center, float radius);
+  Vec3f Center(int i) const {
+    return Vec3f(center_x_[i], center_y_[i], center_z_[i]);
+  }
+  float Radius(int i) const { return radius_[i]; }
+
+  // Returns the index of the closest sphere hit by the ray among the slots
+  // [first, first + count) or -1 if there's none. Results match calling
+  // Sphere::Trace on every sphere within float rounding.
+  int Trace(const Ray& ray, float start, float end, int first, int count,
+            TraceResult* result) const;
+  // Whether the ray hits any of the spheres in the slots
+  // [first, first + count) between start and end.
+  bool Occluded(const Ray& ray, float start, float end, int first,
+                int count) const;
+
+  // Tests all rays of the packet against the sphere in slot i. Rays which
+  // hit it closer than their entry in ends get their end and result
+  // updated. Returns a bit mask of these rays.
+  int TracePacket(int i, const RayPacket& packet, float start, float* ends,
+                  TraceResult* results) const;
+
+ private:
+  AlignedVector<float> center_x_;
+  AlignedVector<float> center_y_;
+  AlignedVector<float> center_z_;
+  AlignedVector<float> radius_;
+  AlignedVector<float> squared_radius_;
+};
+
+#endif  // SPHERE_SET_H_
@@ -0,0 +1,52 @@
+// Copyright 2018, Vahid Kazemi
+
+#include <algorithm>
+
+#include "./tile.h"
+
+namespace {
+
+// Maps a distance along the Hilbert curve filling an n x n grid to its cell.
+void HilbertToXY(int n, int d, int* x, int* y) {
+  *x = *y = 0;
+  for (int s = 1; s < n; s *= 2) {
+    int rx = 1 & (d / 2);
+    int ry = 1 & (d ^ rx);
+    if (ry == 0) {
+      if (rx == 1) {
+        *x = s - 1 - *x;
+        *y = s - 1 - *y;
+      }
+      std::swap(*x, *y);
+    }
+    *x += s * rx;
+    *y += s * ry;
+    d /= 4;
+  }
+}
+
+}  // namespace
+
+std::vector<Tile> MakeTiles(int width, int height, int tile_size) {
+  int nx = (width + tile_size - 1) / tile_size;
+  int ny = (height + tile_size - 1) / tile_size;
+  int n = 1;
+  while (n < nx || n < ny) {
+    n *= 2;
+  }
+
+  std::vector<Tile> tiles;
+  tiles.reserve(nx * ny);
+  for (int d = 0; d < n * n; ++d) {
+    int tx, ty;
+    HilbertToXY(n, d, &tx, &ty);
+    if (tx >= nx || ty >= ny) {
+      continue;
+    }
+    int x0 = tx * tile_size;
+    int y0 = ty * tile_size;
+    tiles.emplace_back(x0, y0, std::min(x0 + tile_size, width),
+                       std::min(y0 + tile_size, height));
+  }
+  return tiles;
+}
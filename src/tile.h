@@ -0,0 +1,23 @@
+// Copyright 2018, Vahid Kazemi
+
+#ifndef TILE_H_
+#define TILE_H_
+
+#include <vector>
+
+// Rectangular block of pixels [x0, x1) x [y0, y1).
+struct Tile {
+  Tile() = default;
+  Tile(int x0, int y0, int x1, int y1) : x0(x0), y0(y0), x1(x1), y1(y1) {}
+
+  int Width() const { return x1 - x0; }
+  int Height() const { return y1 - y0; }
+
+  int x0, y0, x1, y1;
+};
+
+// Splits the image into tiles of the given size ordered along a Hilbert
+// curve, so that consecutive tiles are close to each other.
+std::vector<Tile> MakeTiles(int width, int height, int tile_size);
+
+#endif  // TILE_H_
@@ -20,43 +20,55 @@ struct Vec2 {
 };
 
 template<class T>
-Vec2<T> operator+(const Vec2<T>& v) const {
-  return Vec2<T>(x + v.x, y + v.y);
+Vec2<T> operator+(const Vec2<T>& a, const Vec2<T>& b) {
+  return Vec2<T>(a.x + b.x, a.y + b.y);
 }
 
 template<class T>
-Vec2<T> operator+(T s) const {
-  return Vec2<T>(x + s, y + s);
+Vec2<T> operator-(const Vec2<T>& a, const Vec2<T>& b) {
+  return Vec2<T>(a.x - b.x, a.y - b.y);
 }
 
 template<class T>
-Vec2<T> operator-(const Vec2<T>& v) const {
-  return Vec2<T>(x - v.x, y - v.y);
+Vec2<T> operator-(const Vec2<T>& v) {
+  return Vec2<T>(-v.x, -v.y);
 }
 
 template<class T>
-Vec2<T> operator-(T s) const {
-  return Vec2<T>(x - s, y - s);
+Vec2<T> operator*(const Vec2<T>& a, const Vec2<T>& b) {
+  return Vec2<T>(a.x * b.x, a.y * b.y);
 }
 
 template<class T>
-Vec2<T> operator-() const {
-  return Vec2<T>(-x, -y);
+Vec2<T> operator*(const Vec2<T>& v, T f) {
+  return Vec2<T>(v.x * f, v.y * f);
 }
 
 template<class T>
-Vec2<T> operator*(const Vec2<T>& v) const {
-  return Vec3(x * v.x, y * v.y);
+Vec2<T> operator*(T f, const Vec2<T>& v) {
+  return v * f;
 }
 
 template<class T>
-Vec2<T> operator*(T s) const {
-  return Vec2<T>(x * s, y * s);
+Vec2<T> operator/(const Vec2<T>& a, T f) {
+  return a * (1.0f / f);
 }
 
 template<class T>
-Vec2<T> operator/(T s) const {
-  return *this * (1.0 / s);
+T Dot(const Vec2<T>& a, const Vec2<T>& b) {
+  return a.x * b.x + a.y * b.y;
+}
+
+template<class T>
+std::istream& operator>>(std::istream& is, Vec2<T>& v) {
+  is >> v.x >> v.y;
+  return is;
+}
+
+template<class T>
+std::ostream& operator<<(std::ostream& os, const Vec2<T>& v) {
+  os << v.x << " " << v.y;
+  return os;
 }
 
 typedef Vec2<float> Vec2f;
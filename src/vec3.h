@@ -4,6 +4,7 @@
 #define VEC3_H_
 
 #include <math.h>
+#include <algorithm>
 #include <iostream>
 
 template<class T>
@@ -81,6 +82,16 @@ Vec3<T> Normal(const Vec3<T>& v) {
   return v / Length(v);
 }
 
+template<class T>
+Vec3<T> Min(const Vec3<T>& a, const Vec3<T>& b) {
+  return Vec3<T>(std::min(a.x, b.x), std::min(a.y, b.y), std::min(a.z, b.z));
+}
+
+template<class T>
+Vec3<T> Max(const Vec3<T>& a, const Vec3<T>& b) {
+  return Vec3<T>(std::max(a.x, b.x), std::max(a.y, b.y), std::max(a.z, b.z));
+}
+
 template<class T>
 Vec3<T> Reflect(const Vec3<T>& v, const Vec3<T>& n) {
   return v - 2 * Dot(v, n) * n;
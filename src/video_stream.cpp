@@ -0,0 +1,106 @@
+// Copyright 2018, Vahid Kazemi
+
+#include <string.h>
+#include <strings.h>
+
+#include "./math.h"
+#include "./video_stream.h"
+
+namespace {
+
+uint8_t ToByte(float x) {
+  return static_cast<uint8_t>(Clamp(x + 0.5f, 0.0f, 255.0f));
+}
+
+}  // namespace
+
+VideoStream::~VideoStream() {
+  Close();
+}
+
+bool VideoStream::Open(const char* filename, int fps, bool frame_index) {
+  Close();
+  if (strcmp(filename, "-") == 0) {
+    file_ = stdout;
+  } else {
+    file_ = fopen(filename, "wb");
+    if (!file_) {
+      fprintf(stderr, "Couldn't open stream: %s\n", filename);
+      return false;
+    }
+  }
+  const char* dot = strrchr(filename, '.');
+  y4m_ = dot && strcasecmp(dot, ".y4m") == 0;
+  frame_index_ = frame_index;
+  fps_ = fps > 0 ? fps : 30;
+  width_ = 0;
+  height_ = 0;
+  num_frames_ = 0;
+  return true;
+}
+
+void VideoStream::Close() {
+  if (!file_) {
+    return;
+  }
+  if (file_ == stdout) {
+    fflush(file_);
+  } else {
+    fclose(file_);
+  }
+  file_ = nullptr;
+}
+
+bool VideoStream::WriteFrame(const Image<RGBA>& image) {
+  if (!file_) {
+    return false;
+  }
+  if (num_frames_ == 0) {
+    width_ = image.Width();
+    height_ = image.Height();
+    if (y4m_) {
+      fprintf(file_, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C444\n",
+              width_, height_, fps_);
+    }
+  } else if (image.Width() != width_ || image.Height() != height_) {
+    fprintf(stderr, "Stream frames must all be %dx%d.\n", width_, height_);
+    return false;
+  }
+
+  int num_pixels = width_ * height_;
+  buffer_.resize(3 * num_pixels);
+  if (y4m_) {
+    // Planar Y, Cb and Cr.
+    uint8_t* y = buffer_.data();
+    uint8_t* cb = y + num_pixels;
+    uint8_t* cr = cb + num_pixels;
+    for (int p = 0; p < num_pixels; ++p) {
+      float r = image[p].r / 255.0f;
+      float g = image[p].g / 255.0f;
+      float b = image[p].b / 255.0f;
+      y[p] = ToByte(16 + 65.481f * r + 128.553f * g + 24.966f * b);
+      cb[p] = ToByte(128 - 37.797f * r - 74.203f * g + 112.0f * b);
+      cr[p] = ToByte(128 + 112.0f * r - 93.786f * g - 18.214f * b);
+    }
+    if (frame_index_) {
+      fprintf(file_, "FRAME Xindex=%u\n", num_frames_);
+    } else {
+      fprintf(file_, "FRAME\n");
+    }
+  } else {
+    for (int p = 0; p < num_pixels; ++p) {
+      buffer_[3 * p] = image[p].r;
+      buffer_[3 * p + 1] = image[p].g;
+      buffer_[3 * p + 2] = image[p].b;
+    }
+    if (frame_index_) {
+      uint8_t index[4];
+      for (int i = 0; i < 4; ++i) {
+        index[i] = static_cast<uint8_t>(num_frames_ >> (8 * i));
+      }
+      fwrite(index, 1, sizeof(index), file_);
+    }
+  }
+  num_frames_++;
+  return fwrite(buffer_.data(), 1, buffer_.size(), file_) == buffer_.size();
+}
@@ -0,0 +1,43 @@
+// Copyright 2018, Vahid Kazemi
+
+#ifndef VIDEO_STREAM_H_
+#define VIDEO_STREAM_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+#include "./color.h"
+#include "./image.h"
+
+// Uncompressed video written frame by frame to a file or to stdout, to be
+// piped into an encoder without intermediate images. Files ending in .y4m
+// get YUV4MPEG2 with 4:4:4 BT.601 studio range chroma, anything else gets
+// packed 8 bit RGB frames.
+class VideoStream {
+ public:
+  VideoStream() = default;
+  ~VideoStream();
+
+  // A filename of "-" writes to stdout. With frame_index every frame is
+  // preceded by its index, as an Xindex parameter of the y4m frame header
+  // or as a little endian 32 bit integer in raw streams.
+  bool Open(const char* filename, int fps, bool frame_index);
+  void Close();
+  bool IsOpen() const { return file_ != nullptr; }
+
+  // Appends a frame. All frames must have the same size.
+  bool WriteFrame(const Image<RGBA>& image);
+
+ private:
+  FILE* file_ = nullptr;
+  bool y4m_ = false;
+  bool frame_index_ = false;
+  int fps_ = 30;
+  int width_ = 0;
+  int height_ = 0;
+  uint32_t num_frames_ = 0;
+  std::vector<uint8_t> buffer_;
+};
+
+#endif  // VIDEO_STREAM_H_
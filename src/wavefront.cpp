@@ -0,0 +1,204 @@
+// Copyright 2018, Vahid Kazemi
+
+#include <float.h>
+#include <algorithm>
+
+#include "./roulette.h"
+#include "./wavefront.h"
+
+void PathQueue::Resize(int size) {
+  origin.resize(size);
+  direction.resize(size);
+  throughput.resize(size);
+  radiance.resize(size);
+  pixel.resize(size);
+  sample.resize(size);
+  dimension.resize(size);
+  pdf.resize(size);
+  object.resize(size);
+  hit.resize(size);
+}
+
+Wavefront::Wavefront(const Scene& scene, const Camera& camera,
+                     Sampler* sampler, int max_depth, int roulette_depth,
+                     float roulette_threshold)
+  : scene_(scene), camera_(camera), sampler_(sampler),
+    max_depth_(max_depth), roulette_depth_(roulette_depth),
+    roulette_threshold_(roulette_threshold) {}
+
+void Wavefront::Render(int width, int height, const Tile& region, int first,
+                       int count, int first_sample, int num_samples,
+                       Vec3f* sums, float* squares, GuideBuffers* guides) {
+  Generate(width, height, region, first, count, first_sample, num_samples);
+  for (int depth = 0; paths_.Size() > 0; ++depth) {
+    Intersect();
+    Shade(width, depth, guides);
+    TraceShadows();
+    Finish(sums, squares);
+    Compact();
+  }
+}
+
+void Wavefront::Generate(int width, int height, const Tile& region,
+                         int first, int count, int first_sample,
+                         int num_samples) {
+  paths_.Resize(count * num_samples);
+  int n = 0;
+  for (int r = first; r < first + count; ++r) {
+    int i = region.x0 + r % region.Width();
+    int j = region.y0 + r / region.Width();
+    int p = i + j * width;
+    for (int k = 0; k < num_samples; ++k, ++n) {
+      sampler_->Start(i, j, first_sample + k);
+      Ray ray = camera_.GetRay(i, j, width, height, sampler_);
+      paths_.origin[n] = ray.origin;
+      paths_.direction[n] = ray.direction;
+      paths_.throughput[n] = Vec3f(1, 1, 1);
+      paths_.radiance[n] = Vec3f(0, 0, 0);
+      paths_.pixel[n] = p;
+      paths_.sample[n] = first_sample + k;
+      paths_.dimension[n] = sampler_->Dimension();
+      paths_.pdf[n] = 0;
+    }
+  }
+}
+
+void Wavefront::Intersect() {
+  // Neighbouring paths come from neighbouring pixels, so they are traced
+  // together in packets.
+  int size = paths_.Size();
+  for (int first = 0; first < size; first += RayPacket::kMaxSize) {
+    int count = std::min(size - first, RayPacket::kMaxSize);
+    RayPacket packet;
+    for (int n = first; n < first + count; ++n) {
+      packet.Add(Ray(paths_.origin[n], paths_.direction[n]));
+    }
+    scene_.TracePacket(packet, 0.001, FLT_MAX, &paths_.object[first],
+                       &paths_.hit[first]);
+  }
+}
+
+void Wavefront::Shade(int width, int depth, GuideBuffers* guides) {
+  int size = paths_.Size();
+  alive_.assign(size, false);
+  shadows_.clear();
+  shadow_paths_.clear();
+  if (depth == 0) {
+    for (int n = 0; n < size; ++n) {
+      guides->Add(paths_.pixel[n], scene_, paths_.object[n], paths_.hit[n]);
+    }
+  }
+
+  // Counting sort of the paths by material type so that each material's
+  // code runs over one contiguous group.
+  const MaterialTable& materials = scene_.Materials();
+  int offsets[kNumMaterialTypes + 1] = {};
+  for (int n = 0; n < size; ++n) {
+    int obj = paths_.object[n];
+    if (obj != kNoObject) {
+      int material = scene_.MaterialId(obj);
+      offsets[materials.Type(material) + 1]++;
+      Vec3f emitted = materials.Emitted(material);
+      if (emitted.x > 0 || emitted.y > 0 || emitted.z > 0) {
+        Ray ray(paths_.origin[n], paths_.direction[n]);
+        paths_.radiance[n] = paths_.radiance[n] + paths_.throughput[n] *
+          emitted * EmissionWeight(scene_, ray, obj, paths_.pdf[n]);
+      }
+    } else {
+      Ray ray(paths_.origin[n], paths_.direction[n]);
+      paths_.radiance[n] = paths_.radiance[n] + paths_.throughput[n] *
+        scene_.Background(ray) * EmissionWeight(scene_, ray, kNoObject,
+                                                paths_.pdf[n]);
+    }
+  }
+  if (depth >= max_depth_) {
+    // Paths which hit a surface at the maximum depth end there.
+    return;
+  }
+  for (int t = 0; t < kNumMaterialTypes; ++t) {
+    offsets[t + 1] += offsets[t];
+  }
+  order_.resize(offsets[kNumMaterialTypes]);
+  for (int n = 0; n < size; ++n) {
+    int obj = paths_.object[n];
+    if (obj != kNoObject) {
+      order_[offsets[materials.Type(scene_.MaterialId(obj))]++] = n;
+    }
+  }
+
+  for (int n : order_) {
+    Ray ray(paths_.origin[n], paths_.direction[n]);
+    Vec3f attenuation;
+    Ray scattered;
+    int pixel = paths_.pixel[n];
+    sampler_->Start(pixel % width, pixel / width, paths_.sample[n],
+                    paths_.dimension[n]);
+    bool scatter = materials.Scatter(scene_.MaterialId(paths_.object[n]), ray,
+                                     paths_.hit[n], sampler_, &attenuation,
+                                     &scattered);
+    if (scatter) {
+      ShadowRay shadow;
+      if (SampleLights(scene_, paths_.object[n], paths_.hit[n], sampler_,
+                       &shadow)) {
+        shadow.radiance = paths_.throughput[n] * shadow.radiance;
+        shadows_.push_back(shadow);
+        shadow_paths_.push_back(n);
+      }
+      paths_.pdf[n] = ScatterPdf(scene_, paths_.object[n], paths_.hit[n],
+                                 scattered);
+      Vec3f throughput = paths_.throughput[n] * attenuation;
+      if (depth + 1 < roulette_depth_ ||
+          SurvivesRoulette(roulette_threshold_, &throughput, sampler_)) {
+        paths_.origin[n] = scattered.origin;
+        paths_.direction[n] = scattered.direction;
+        paths_.throughput[n] = throughput;
+        alive_[n] = true;
+      }
+    }
+    paths_.dimension[n] = sampler_->Dimension();
+  }
+}
+
+void Wavefront::TraceShadows() {
+  for (size_t s = 0; s < shadows_.size(); ++s) {
+    const ShadowRay& shadow = shadows_[s];
+    if (!scene_.Occluded(shadow.ray, 0.001, shadow.distance)) {
+      int n = shadow_paths_[s];
+      paths_.radiance[n] = paths_.radiance[n] + shadow.radiance;
+    }
+  }
+}
+
+void Wavefront::Finish(Vec3f* sums, float* squares) {
+  int size = paths_.Size();
+  for (int n = 0; n < size; ++n) {
+    if (!alive_[n]) {
+      int pixel = paths_.pixel[n];
+      float y = Luminance(paths_.radiance[n]);
+      sums[pixel] = sums[pixel] + paths_.radiance[n];
+      squares[pixel] += y * y;
+    }
+  }
+}
+
+void Wavefront::Compact() {
+  int size = paths_.Size();
+  int live = 0;
+  for (int n = 0; n < size; ++n) {
+    if (!alive_[n]) {
+      continue;
+    }
+    if (live != n) {
+      paths_.origin[live] = paths_.origin[n];
+      paths_.direction[live] = paths_.direction[n];
+      paths_.throughput[live] = paths_.throughput[n];
+      paths_.radiance[live] = paths_.radiance[n];
+      paths_.pixel[live] = paths_.pixel[n];
+      paths_.sample[live] = paths_.sample[n];
+      paths_.dimension[live] = paths_.dimension[n];
+      paths_.pdf[live] = paths_.pdf[n];
+    }
+    live++;
+  }
+  paths_.Resize(live);
+}
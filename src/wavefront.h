@@ -0,0 +1,90 @@
+// Copyright 2018, Vahid Kazemi
+
+#ifndef WAVEFRONT_H_
+#define WAVEFRONT_H_
+
+#include <stdint.h>
+#include <vector>
+
+#include "./camera.h"
+#include "./denoiser.h"
+#include "./lighting.h"
+#include "./sampler.h"
+#include "./scene.h"
+#include "./tile.h"
+#include "./vec3.h"
+
+// Path states in structure of arrays layout.
+struct PathQueue {
+  void Resize(int size);
+  int Size() const { return static_cast<int>(pixel.size()); }
+
+  std::vector<Vec3f> origin;
+  std::vector<Vec3f> direction;
+  std::vector<Vec3f> throughput;
+  // Radiance gathered so far, added to the pixel when the path ends.
+  std::vector<Vec3f> radiance;
+  std::vector<int> pixel;
+  // Position of the path in its sample, see Sampler::Start.
+  std::vector<int> sample;
+  std::vector<uint32_t> dimension;
+  // Density of the scatter which led to the current ray, see
+  // EmissionWeight.
+  std::vector<float> pdf;
+  // Closest hit found by the intersection stage, object ids of the scene.
+  std::vector<int> object;
+  std::vector<TraceResult> hit;
+};
+
+// Breadth first path tracer. Rather than following one path to the end
+// before starting the next, a whole batch of paths is advanced one bounce at
+// a time through separate stages: ray generation, intersection, material
+// evaluation grouped by material type, shadow rays and accumulation.
+// Terminated paths are compacted out after every bounce. The estimate is the
+// same as the one of Pathtracer::Trace.
+class Wavefront {
+ public:
+  Wavefront(const Scene& scene, const Camera& camera, Sampler* sampler,
+            int max_depth, int roulette_depth, float roulette_threshold);
+
+  // Traces samples [first_sample, first_sample + num_samples) through
+  // pixels [first, first + count) of region, counted row by row, of a
+  // width x height image. Adds their radiance to sums[pixel], its squared
+  // luminance to squares[pixel] and their first hits to guides, where pixel
+  // is x + y * width.
+  void Render(int width, int height, const Tile& region, int first,
+              int count, int first_sample, int num_samples, Vec3f* sums,
+              float* squares, GuideBuffers* guides);
+
+ private:
+  void Generate(int width, int height, const Tile& region, int first,
+                int count, int first_sample, int num_samples);
+  void Intersect();
+  // Accumulates the background of escaped paths and the emission of hit
+  // surfaces, scatters the paths and queues their shadow rays. The hits of
+  // the primary rays are added to guides.
+  void Shade(int width, int depth, GuideBuffers* guides);
+  // Adds the light arriving through the unblocked shadow rays.
+  void TraceShadows();
+  // Adds the radiance of the paths which ended to their pixels.
+  void Finish(Vec3f* sums, float* squares);
+  // Moves the surviving paths to the front of the queue.
+  void Compact();
+
+  const Scene& scene_;
+  const Camera& camera_;
+  Sampler* sampler_;
+  int max_depth_;
+  int roulette_depth_;
+  float roulette_threshold_;
+  PathQueue paths_;
+  std::vector<bool> alive_;
+  // Shadow rays of the current bounce, with the throughput of their path
+  // applied, and the index of the path.
+  std::vector<ShadowRay> shadows_;
+  std::vector<int> shadow_paths_;
+  // Indices of the paths which hit a surface, sorted by material type.
+  std::vector<int> order_;
+};
+
+#endif  // WAVEFRONT_H_